@@ -0,0 +1,258 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "chart-app.h"
+
+/*
+ * Attachment -- a viewer's connection to stripchartd.  Parameters the
+ * daemon samples are matched to the config's by name; values[id] holds
+ * the latest column for each, read back by chart_tick_at, which stamps
+ * it with the daemon's time for the tick.
+ */
+typedef struct
+{
+  Chart_app *app;
+  Param_desc **desc;
+  gint nparams, live;
+  gdouble *values;
+  ChartDatum **datum;
+}
+Attachment;
+
+static gdouble
+feed_value(gdouble *value)
+{
+  return *value;
+}
+
+/*
+ * chart_app_feed -- plots a parameter whose values come from elsewhere,
+ * read from *value on each tick, rather than from its equation.  It's
+ * matched to the config's parameters by name and takes over that one's
+ * page; a name the config hasn't got gets a page of its own.
+ */
+ChartDatum *
+chart_app_feed(Chart_app *app, Param_desc **all, const char *name,
+  gdouble *value)
+{
+  gint p, pageno;
+  Param_desc *desc = NULL, named;
+  Param_page *page;
+
+  for (p = 0; all && all[p]; p++)
+    if (all[p]->name && strcmp(all[p]->name, name) == 0)
+      break;
+
+  if (all && all[p])
+    {
+      desc = all[p];
+      pageno = p;
+      page = g_object_get_data(G_OBJECT(
+	gtk_notebook_get_nth_page(app->notebook, p)), "page");
+    }
+  else
+    {
+      memset(&named, 0, sizeof(named));
+      named.name = (char *)name;
+      desc = &named;
+      pageno = gtk_notebook_get_n_pages(app->notebook);
+      page = add_page_before(app, pageno, desc);
+    }
+
+  if (page->strip_data)
+    {
+      chart_parameter_deactivate(CHART(app->strip), page->strip_data);
+      chart_parameter_unref(page->strip_data);
+    }
+  page->strip_data = chart_desc_add(CHART(app->strip),
+    feed_value, value, desc, NULL, pageno,
+    str_to_plot_style(desc->plot) != chart_plot_indicator);
+  page->strip_data->skip = 0;
+  return page->strip_data;
+}
+
+static void
+attach_param(Attachment *at, gint id, const char *name)
+{
+  at->datum[id] = chart_parameter_ref(
+    chart_app_feed(at->app, at->desc, name, &at->values[id]));
+}
+
+/*
+ * attach_line -- handles one line of the stripchartd protocol; see
+ * stripchartd.c.  Returns FALSE on anything it can't make sense of.
+ */
+static gboolean
+attach_line(Attachment *at, char *line)
+{
+  gint id, n, i;
+  char *s, *e;
+
+  if (sscanf(line, "stripchartd 2 %*d %d", &n) == 1 && at->values == NULL)
+    {
+      at->nparams = n;
+      at->values = g_malloc0((n ? n : 1) * sizeof(*at->values));
+      at->datum = g_malloc0((n ? n : 1) * sizeof(*at->datum));
+      return TRUE;
+    }
+  if (at->values == NULL)
+    return FALSE;
+
+  if (strncmp(line, "param ", 6) == 0)
+    {
+      id = strtol(line + 6, &s, 10);
+      if (id < 0 || id >= at->nparams || *s++ != ' ' || at->datum[id])
+	return FALSE;
+      attach_param(at, id, s);
+      return TRUE;
+    }
+
+  if (strncmp(line, "history ", 8) == 0)
+    {
+      gfloat *vals;
+      gdouble *times;
+
+      id = strtol(line + 8, &s, 10);
+      n = strtol(s, &s, 10);
+      if (id < 0 || id >= at->nparams || at->datum[id] == NULL || n < 0)
+	return FALSE;
+      vals = g_malloc((n ? n : 1) * sizeof(*vals));
+      times = g_malloc((n ? n : 1) * sizeof(*times));
+      for (i = 0; i < n; i++)
+	{
+	  times[i] = g_ascii_strtod(s, &e);
+	  if (e == s)
+	    break;
+	  vals[i] = g_ascii_strtod(s = e, &e);
+	  if (e == s)
+	    break;
+	  s = e;
+	}
+      chart_parameter_backfill(at->datum[id], times, vals, i);
+      g_free(times);
+      g_free(vals);
+      return TRUE;
+    }
+
+  if (strcmp(line, "end") == 0)
+    {
+      at->live = TRUE;
+      gtk_widget_queue_draw(at->app->strip);
+      return TRUE;
+    }
+
+  if (at->live && strncmp(line, "tick ", 5) == 0)
+    {
+      gdouble t = g_ascii_strtod(line + 5, &s);
+
+      if (s == line + 5)
+	return FALSE;
+      for (id = 0; id < at->nparams; id++, s = e)
+	{
+	  at->values[id] = g_ascii_strtod(s, &e);
+	  if (e == s)
+	    return FALSE;
+	}
+      chart_tick_at(CHART(at->app->strip), t);
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gboolean
+attach_read(GIOChannel *chan, GIOCondition cond, Attachment *at)
+{
+  gchar *line;
+  gsize term;
+  GIOStatus status;
+
+  while ((status = g_io_channel_read_line(chan, &line, NULL, &term, NULL))
+    == G_IO_STATUS_NORMAL)
+    {
+      gboolean ok;
+      line[term] = '\0';
+      ok = attach_line(at, line);
+      g_free(line);
+      if (!ok)
+	{
+	  status = G_IO_STATUS_ERROR;
+	  break;
+	}
+    }
+
+  if (status == G_IO_STATUS_AGAIN)
+    return TRUE;
+
+  error("lost connection to stripchartd");
+  return FALSE;
+}
+
+/*
+ * chart_app_attach -- plots the parameters a stripchartd collector is
+ * sampling, instead of sampling them here.  The chart's own timer is
+ * stopped; it's stepped once per tick the daemon sends.
+ */
+gboolean
+chart_app_attach(Chart_app *app, const char *path, Param_desc **desc)
+{
+  int fd;
+  struct sockaddr_un sun;
+  GIOChannel *chan;
+  Attachment *at;
+
+  memset(&sun, 0, sizeof(sun));
+  sun.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(sun.sun_path))
+    {
+      error("socket path too long: %s", path);
+      return FALSE;
+    }
+  strcpy(sun.sun_path, path);
+
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+    || connect(fd, (struct sockaddr *)&sun, sizeof(sun)) < 0)
+    {
+      error("can't attach to \"%s\": %s", path, strerror(errno));
+      if (fd >= 0)
+	close(fd);
+      return FALSE;
+    }
+
+  at = g_malloc0(sizeof(*at));
+  at->app = app;
+  at->desc = desc;
+
+  chan = g_io_channel_unix_new(fd);
+  g_io_channel_set_close_on_unref(chan, TRUE);
+  g_io_channel_set_encoding(chan, NULL, NULL);
+  g_io_channel_set_flags(chan, G_IO_FLAG_NONBLOCK, NULL);
+  g_io_add_watch(chan, G_IO_IN | G_IO_HUP | G_IO_ERR,
+    (GIOFunc)attach_read, at);
+  g_io_channel_unref(chan);
+
+  chart_set_interval(CHART(app->strip), 0);
+  return TRUE;
+}
@@ -18,6 +18,7 @@
 #include "chart-app.h"
 #include "strip.h"
 
+#include <math.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 
@@ -84,20 +85,43 @@ enum {
 	TEXT_COLUMN_SCALE,
 	TEXT_COLUMN_BOT,
 	TEXT_COLUMN_TOP,
+	TEXT_COLUMN_QUANTILES,
+	TEXT_COLUMN_MEMORY,
 	TEXT_COLUMN_COLOR,
 	TEXT_COLUMNS
 };
 
+/*
+ * text_quantiles -- a percentile plot's recent p50, p95 and p99, or
+ * nothing for other plots.
+ */
+static void
+text_quantiles(ChartDatum *datum, char *str)
+{
+  gint k;
+  char vs[50];
+
+  *str = '\0';
+  if (datum->quantiles == NULL || datum->quantiles->recent.count <= 0)
+    return;
+  for (k = 0; k < CHART_QUANTILES; k++)
+    {
+      val_fmt(sketch_quantile(&datum->quantiles->recent, chart_quantile[k]), vs);
+      str += sprintf(str, k ? " %s" : "%s", vs);
+    }
+}
+
 /*
  * text_load_tree -- fills a tree with chart ident, current, and top values.
  */
 static void
 text_load_tree(Chart_app *app)
 {
-  int p = 0;
+  int p = 0, n;
   GtkWidget *nb_page;
   GtkTreeIter iter;
-  char val_str[50], top_str[50], bot_str[50];
+  char val_str[50], top_str[50], bot_str[50], mem_str[50], quant_str[50], title[100];
+  gsize bytes, total = 0;
 
   g_object_freeze_notify(G_OBJECT(app->text_store));
   gtk_list_store_clear(app->text_store);
@@ -107,18 +131,24 @@ text_load_tree(Chart_app *app)
       Param_page *page = g_object_get_data(G_OBJECT(nb_page), "page");
       ChartDatum *datum = page->strip_data;
 
-      if (datum && datum->active)
+      if (datum && chart_parameter_active(datum))
 	{
 	  char *name = gtk_editable_get_chars(GTK_EDITABLE(page->name), 0,-1);
-	  val_fmt(datum->history[datum->newest], val_str);
+	  val_fmt(datum->history.values[datum->history.newest], val_str);
 	  val_fmt(datum->adj->lower, bot_str);
 	  val_fmt(datum->adj->upper, top_str);
+	  bytes = chart_parameter_bytes(datum);
+	  total += bytes;
+	  g_snprintf(mem_str, sizeof(mem_str), "%.0fk", bytes / 1024.0);
+	  text_quantiles(datum, quant_str);
 	  gtk_list_store_insert_with_values(app->text_store, &iter, -1,
 			  TEXT_COLUMN_PARAM, name,
 			  TEXT_COLUMN_CURRENT, val_str,
 			  TEXT_COLUMN_SCALE, param_type_str(page),
 			  TEXT_COLUMN_BOT, bot_str,
 			  TEXT_COLUMN_TOP, top_str,
+			  TEXT_COLUMN_QUANTILES, quant_str,
+			  TEXT_COLUMN_MEMORY, mem_str,
 			  TEXT_COLUMN_COLOR, &page->strip_data->gdk_color[0],
 			  -1);
 
@@ -127,18 +157,84 @@ text_load_tree(Chart_app *app)
     }
 
   g_object_thaw_notify(G_OBJECT(app->text_store));
+
+  /* What autoranging has cost, for tuning the rescale preferences. */
+  n = sprintf(title, "Values: %u rescales, %u redraws, %.0fk of history",
+    CHART(app->strip)->rescales, STRIP(app->strip)->redraws, total / 1024.0);
+  if (app->recorder)
+    sprintf(title + n, ", %u recordings", recorder_saved(app->recorder));
+  gtk_window_set_title(GTK_WINDOW(app->text_window), title);
 }
 
 /*
- * text_refresh -- if the text window is up, refresh the values.
+ * reclog_sampled -- hands the recording log each parameter's value as
+ * of this tick, stamped with the tick's own time when attached or
+ * replaying.  Its columns follow the pages, so a parameter that's
+ * edited carries on in the same one.
+ */
+static void
+reclog_sampled(Chart *chart, Chart_app *app)
+{
+  gint p;
+  GtkWidget *nb_page;
+
+  for (p = 0; p < app->reclog_params; p++)
+    {
+      ChartDatum *datum = NULL;
+
+      if ((nb_page = gtk_notebook_get_nth_page(app->notebook, p)) != NULL)
+	datum = ((Param_page *)g_object_get_data(G_OBJECT(nb_page), "page"))->strip_data;
+      app->reclog_values[p] = datum ? chart_parameter_value(datum) : NAN;
+    }
+  reclog_tick(app->reclog,
+    chart->tick_t ? chart->tick_t : g_get_real_time() / 1e6, app->reclog_values);
+}
+
+/*
+ * text_viewable -- whether the text window can be seen at all.
+ */
+static gboolean
+text_viewable(Chart_app *app)
+{
+  GdkWindow *window;
+
+  if (app->text_window == NULL || app->text_obscured)
+    return FALSE;
+  if ((window = app->text_window->window) == NULL)
+    return FALSE;
+  return gdk_window_is_viewable(window)
+    && !(gdk_window_get_state(window) & GDK_WINDOW_STATE_ICONIFIED);
+}
+
+/*
+ * text_refresh -- if the text window can be seen, refresh the values.
  */
 void
 text_refresh(Chart *chart, Chart_app *app)
 {
-  if (app->text_window && GTK_WIDGET_VISIBLE(app->text_window))
+  if (text_viewable(app))
     text_load_tree(app);
 }
 
+/*
+ * on_text_visibility -- catches the text window up as it comes back
+ * into view, having skipped refreshes while it was out of sight.
+ */
+static gboolean
+on_text_visibility(GtkWidget *win, GdkEvent *event, Chart_app *app)
+{
+  if (event->type == GDK_VISIBILITY_NOTIFY)
+    app->text_obscured =
+      event->visibility.state == GDK_VISIBILITY_FULLY_OBSCURED;
+  else if (event->type == GDK_WINDOW_STATE
+    && !(event->window_state.changed_mask & GDK_WINDOW_STATE_ICONIFIED))
+    return FALSE;
+
+  if (text_viewable(app))
+    text_load_tree(app);
+  return FALSE;
+}
+
 /*
  * on_show_values -- pops up a top level textual display of current
  * parameter values in response to a mouse click.  Closes this window
@@ -159,6 +255,8 @@ on_show_values(GtkWidget *unused, Chart_app *app)
 	      { "Scale", 	G_TYPE_STRING, TRUE },
 	      { "Bot",		G_TYPE_STRING, TRUE },
 	      { "Top",		G_TYPE_STRING, TRUE },
+	      { "p50 p95 p99",	G_TYPE_STRING, TRUE },
+	      { "Memory",	G_TYPE_STRING, TRUE },
 	      { "Color",	GDK_TYPE_COLOR, FALSE }
       };
 
@@ -199,6 +297,14 @@ on_show_values(GtkWidget *unused, Chart_app *app)
 
       g_signal_connect(G_OBJECT(app->text_window),
 	"delete-event", G_CALLBACK(gtk_widget_hide), app->text_window);
+
+      gtk_widget_add_events(app->text_window, GDK_VISIBILITY_NOTIFY_MASK);
+      g_signal_connect(G_OBJECT(app->text_window),
+	"visibility-notify-event", G_CALLBACK(on_text_visibility), app);
+      g_signal_connect(G_OBJECT(app->text_window),
+	"window-state-event", G_CALLBACK(on_text_visibility), app);
+      g_signal_connect(G_OBJECT(app->text_window),
+	"map-event", G_CALLBACK(on_text_visibility), app);
     }
   else if (GTK_WIDGET_VISIBLE(app->text_window))
     gtk_widget_hide(app->text_window);
@@ -272,17 +378,31 @@ on_popup_menu(GtkWidget *win, Chart_app *app)
 	return TRUE;
 }
 
+static void
+error_dialog(const char *msg)
+{
+  GtkWidget *dialog = gtk_message_dialog_new(NULL, GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK, "%s", msg);
+  gtk_dialog_run(GTK_DIALOG(dialog));
+  gtk_widget_destroy(dialog);
+}
+
 Chart_app *
 chart_app_new(void)
 {
   int p;
-  char *config_path[20];
-  struct stat stat_buf;
+  const char *fn;
   Param_desc **param_desc = NULL;
   Chart_app *app = g_malloc(sizeof(*app));
 
+  error_set_handler(error_dialog);
+
   app->strip_param_group = g_malloc0(sizeof(*app->strip_param_group));
   app->text_window = NULL;
+  app->text_obscured = FALSE;
+  app->recorder = NULL;
+  app->reclog = NULL;
+  app->replay = NULL;
+  app->fed = attach_path != NULL || replay_fn != NULL;
 
   app->hbox = gtk_hbox_new(/*homo*/0, /*pad*/0);
   gtk_widget_show(app->hbox);
@@ -302,29 +422,29 @@ chart_app_new(void)
   app->strip_param_group->interval = 5000;
   gettimeofday(&app->strip_param_group->t_now, NULL);
 
-  p = 0;
   app->config_fn = g_strdup_printf("%s/.stripchart.conf", getenv("HOME"));
-  if (config_fn != NULL)
-    config_path[p++] = config_fn;
-  else
+  if ((fn = config_file_find(config_fn)) != NULL)
     {
-      config_path[p++] = app->config_fn;
-      config_path[p++] = g_strdup("stripchart.conf");
+      param_desc = param_desc_ingest(fn);
+      prefs_ingest(app, fn);
     }
-  config_path[p] = NULL;
-
-  for (p = 0; config_path[p] != NULL; p++)
-    if (stat(config_path[p], &stat_buf) == 0)
-      {
-	param_desc = param_desc_ingest(config_path[p]);
-	prefs_ingest(app, config_path[p]);
-	break;
-      }
-  if (config_path[p] == NULL)
+  else
     error("no config file found, proceeding anyway\n");
 
   strip_set_default_history_size(STRIP(app->strip), gdk_screen_width());
+  chart_set_align(CHART(app->strip), app->strip_param_group->align);
+  chart_set_column_ticks(CHART(app->strip),
+    prefs_column_ticks(app->strip_param_group));
   chart_set_interval(CHART(app->strip), app->strip_param_group->interval);
+  if (retain_hours > 0 && app->strip_param_group->interval > 0)
+    chart_set_retain(CHART(app->strip), retain_hours * 3600e3
+      / app->strip_param_group->interval
+      / prefs_column_ticks(app->strip_param_group));
+  if (history_dir && !app->fed)
+    {
+      g_mkdir_with_parents(history_dir, 0755);
+      chart_set_history_dir(CHART(app->strip), history_dir);
+    }
 
   create_editor(app);
 
@@ -333,10 +453,47 @@ chart_app_new(void)
       {
 	Param_page *page = add_page_before(app, p, param_desc[p]);
 
-	page->strip_data = chart_equation_add(CHART(app->strip),
-	  app->strip_param_group, param_desc[p], NULL, 0,
-	  str_to_plot_style(param_desc[p]->plot) != chart_plot_indicator);
+	if (!app->fed)
+	  page->strip_data = chart_equation_add(CHART(app->strip),
+	    app->strip_param_group, param_desc[p], NULL, 0,
+	    str_to_plot_style(param_desc[p]->plot) != chart_plot_indicator);
       }
 
+  if (attach_path)
+    chart_app_attach(app, attach_path, param_desc);
+  else if (replay_fn)
+    app->replay = chart_app_replay(app, replay_fn, param_desc, replay_speed);
+  else if (record_dir && param_desc)
+    {
+      app->recorder = recorder_new(record_dir, record_hz, record_seconds);
+      for (p = 0; param_desc[p]; p++)
+	recorder_add(app->recorder, param_desc[p]);
+      if (recorder_params(app->recorder) == 0)
+	error("nothing to record: mark parameters with <record> or <trigger>\n");
+      g_mkdir_with_parents(record_dir, 0755);
+      recorder_start(app->recorder);
+    }
+
+  if (record_log && param_desc)
+    {
+      const char **names;
+
+      for (p = 0; param_desc[p]; p++)
+	;
+      names = g_new(const char *, p);
+      for (p = 0; param_desc[p]; p++)
+	names[p] = param_desc[p]->name;
+      if ((app->reclog = reclog_open(record_log, p, names)) != NULL)
+	{
+	  app->reclog_params = p;
+	  app->reclog_values = g_new(gfloat, p);
+	  g_signal_connect(G_OBJECT(app->strip),
+	    "chart_sampled", G_CALLBACK(reclog_sampled), app);
+	}
+      g_free(names);
+    }
+  else if (record_log)
+    error("no parameters to record\n");
+
   return app;
 }
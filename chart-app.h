@@ -22,9 +22,21 @@
 
 #include "chart.h"
 #include "strip.h"
+#include "utils.h"
+#include "ingest.h"
+#include "expr.h"
+#include "recorder.h"
+#include "reclog.h"
 
-extern char *prog_name;
 extern char *config_fn;
+extern char *attach_path;
+extern char *history_dir;
+extern gdouble retain_hours;
+extern char *record_dir;
+extern gdouble record_hz, record_seconds;
+extern char *record_log;
+extern char *replay_fn;
+extern gdouble replay_speed;
 
 typedef struct _Chart_app
 {
@@ -34,18 +46,30 @@ typedef struct _Chart_app
   GtkWidget *frame, *hbox, *strip;
   GtkWidget *text_window, *editor, *edit_apply, *edit_addcolor, *edit_rmcolor;
   GtkListStore *text_store;
+  gboolean text_obscured;
   GtkNotebook *notebook;
+  gboolean fed;			/* by stripchartd or a recording, not sampled here */
+  Recorder *recorder;		/* the flight recorder, if it's on */
+  Reclog *reclog;		/* the recording log, if there is one */
+  gint reclog_params;		/* pages it has columns for */
+  gfloat *reclog_values;
+  struct _Replay *replay;	/* the recording being played back, if any */
 }
 Chart_app;
 
 #include "prefs.h"
 #include "params.h"
 #include "eval.h"
-#include "utils.h"
+#include "profile.h"
 
 gboolean on_button_press(GtkWidget *win, GdkEventButton *event, Chart_app *app);
 gboolean on_popup_menu(GtkWidget *win, Chart_app *app);
 void text_refresh(Chart *chart, Chart_app *app);
 Chart_app *chart_app_new(void);
+gboolean chart_app_attach(Chart_app *app, const char *path, Param_desc **desc);
+ChartDatum *chart_app_feed(Chart_app *app, Param_desc **all, const char *name,
+  gdouble *value);
+struct _Replay *chart_app_replay(Chart_app *app, const char *fn,
+  Param_desc **desc, gdouble speed);
 
 #endif /* CHART_APP_H */
@@ -20,8 +20,9 @@
 #include <string.h>
 
 #include "chart.h"
+#include "tick.h"
 
-enum { PRE_UPDATE, POST_UPDATE, RESCALE, SIGNAL_COUNT };
+enum { PRE_UPDATE, SAMPLED, POST_UPDATE, RESCALE, SIGNAL_COUNT };
 static gint chart_signals[SIGNAL_COUNT] = { 0 };
 
 static void 
@@ -36,6 +37,13 @@ chart_class_init(ChartClass *klass)
 		    NULL, NULL,
 		    g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
 
+  chart_signals[SAMPLED] = 
+    g_signal_new("chart_sampled", 
+		    G_TYPE_FROM_CLASS(object_class), G_SIGNAL_RUN_FIRST, 
+		    G_STRUCT_OFFSET(ChartClass, chart_sampled),
+		    NULL, NULL,
+		    g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
   chart_signals[POST_UPDATE] = 
     g_signal_new("chart_post_update", 
 		    G_TYPE_FROM_CLASS(object_class), G_SIGNAL_RUN_FIRST, 
@@ -63,17 +71,51 @@ chart_configure(GtkWidget *widget, GdkEvent *event, void *nil)
     CHART(widget)->colormap = gdk_drawable_get_colormap(widget->window);
 }
 
+static gboolean
+chart_visibility(GtkWidget *widget, GdkEventVisibility *event, void *nil)
+{
+  CHART(widget)->obscured = event->state == GDK_VISIBILITY_FULLY_OBSCURED;
+  return FALSE;
+}
+
+/*
+ * chart_viewable -- whether drawing the chart would show anything: its
+ * window and all its ancestors are mapped, the toplevel isn't
+ * iconified, and other windows don't cover it completely.
+ */
+gboolean
+chart_viewable(Chart *chart)
+{
+  GtkWidget *widget = GTK_WIDGET(chart);
+  GtkWidget *top = gtk_widget_get_toplevel(widget);
+
+  if (!GTK_WIDGET_REALIZED(widget) || chart->obscured)
+    return FALSE;
+  if (!gdk_window_is_viewable(widget->window))
+    return FALSE;
+  if (top->window
+    && (gdk_window_get_state(top->window) & GDK_WINDOW_STATE_ICONIFIED))
+    return FALSE;
+  return TRUE;
+}
+
 static void
 chart_object_init(Chart *chart)
 {
-  chart->param = NULL;
+  chart->hot = NULL;
+  chart->slots = chart->slot_cap = 0;
+  chart->order = NULL;
+  chart->params = 0;
   chart->default_history_size = 1;
   chart->default_plot_style = chart_plot_line;
   chart->default_scale_style = chart_scale_linear;
+  chart->column_ticks = 1;
 
   chart_set_interval(chart, 1000);
 
   g_signal_connect(chart, "configure_event", G_CALLBACK(chart_configure), NULL);
+  gtk_widget_add_events(GTK_WIDGET(chart), GDK_VISIBILITY_NOTIFY_MASK);
+  g_signal_connect(chart, "visibility-notify-event", G_CALLBACK(chart_visibility), NULL);
 }
 
 GType
@@ -143,111 +185,745 @@ static guint chart_range(gdouble *bound, gdouble val, gdouble min, gdouble max,
 	return 0;
 }
 
-static guint chart_rescale_range(ChartDatum *datum)
+/*
+ * chart_rescale_bound -- moves a bound to wherever chart_range would
+ * put it.  A bound that grows moves at once, so nothing is clipped.  A
+ * bound that shrinks waits until the data has kept clear of it by the
+ * chart's hysteresis, a fraction of the range, for its hold time; a
+ * noisy series near a step then doesn't flip the scale back and forth.
+ */
+static guint chart_rescale_bound(Chart *chart, ChartDatum *datum,
+  gdouble *bound, gdouble val, gdouble min, gdouble max, gboolean side,
+  gint64 now)
+{
+	gdouble b = *bound;
+	gint64 *since = &datum->shrink_since[side];
+
+	if (!chart_range(&b, val, min, max, side))
+	{
+		*since = 0;
+		return 0;
+	}
+	if (side ? b > *bound : b < *bound)
+	{
+		gdouble margin = chart->hysteresis
+		  * (datum->adj->upper - datum->adj->lower);
+
+		if (!isfinite(margin))
+			margin = 0;
+		if ((side ? val - *bound : *bound - val) < margin)
+		{
+			*since = 0;
+			return 0;
+		}
+		if (*since == 0)
+			*since = now;
+		if (now - *since < chart->hold * (gint64)1000)
+			return 0;
+	}
+	*since = 0;
+	*bound = b;
+	return 1;
+}
+
+static guint chart_rescale_range(Chart *chart, ChartDatum *datum, gint64 now)
 {
 	guint changed = 0;
-	changed += chart_range(&datum->adj->upper, datum->max, datum->top_min, datum->top_max, 0);
-	changed += chart_range(&datum->adj->lower, datum->min, datum->bot_min, datum->bot_max, 1);
+	changed += chart_rescale_bound(chart, datum, &datum->adj->upper,
+	  datum->max, datum->top_min, datum->top_max, 0, now);
+	changed += chart_rescale_bound(chart, datum, &datum->adj->lower,
+	  datum->min, datum->bot_min, datum->bot_max, 1, now);
 	return changed;
 }
 
+/*
+ * chart_parameter_deactivate -- stops sampling a parameter, and frees
+ * what it was sampled with, at once.  What it has plotted scrolls off
+ * the chart before the chart lets go of it.
+ */
 void
 chart_parameter_deactivate(Chart *chart, ChartDatum *param)
 {
-  if (param)
-    param->active = FALSE;
+  if (param == NULL || !chart_parameter_active(param))
+    return;
+
+  CHART_HOT(param)->active = FALSE;
+  chart->rebalance = TRUE;
+  wheel_remove(&chart->wheel, &param->timer);
+  if (param->user_free && param->user_data)
+    param->user_free(param->user_data);
+  param->user_func = NULL;
+  param->user_time = NULL;
+  param->user_data = NULL;
+  param->user_free = NULL;
+}
+
+/*
+ * chart_column_add -- counts a sample into the column being filled.
+ */
+static void
+chart_column_add(ChartDatum *datum, gdouble val)
+{
+  ChartHot *hot = CHART_HOT(datum);
+
+  if (datum->quantiles)
+    sketch_add(&datum->quantiles->column, val);
+  if (isfinite(val))
+    {
+      if (hot->col_n++ == 0)
+	hot->col_min = hot->col_max = val;
+      else if (val < hot->col_min)
+	hot->col_min = val;
+      else if (hot->col_max < val)
+	hot->col_max = val;
+      hot->col_sum += val;
+    }
+}
+
+/*
+ * chart_parameter_fold -- counts a sample taken between ticks into the
+ * column, for sources that get several a tick; user_func's value is
+ * the last of them.  Priming samples are thrown away, as usual.
+ */
+void
+chart_parameter_fold(ChartDatum *datum, gdouble val)
+{
+  if (chart_parameter_active(datum) && datum->skip == 0)
+    chart_column_add(datum, val);
+}
+
+/*
+ * chart_parameter_active -- whether a parameter is still sampled.
+ */
+gboolean
+chart_parameter_active(const ChartDatum *datum)
+{
+  return datum->slot >= 0 && CHART_HOT(datum)->active;
+}
+
+/*
+ * chart_parameter_value -- a parameter's value as of this tick,
+ * sampled or held; NAN if it's inactive or yet to be sampled.
+ */
+gdouble
+chart_parameter_value(const ChartDatum *datum)
+{
+  const ChartHot *hot;
+
+  if (!chart_parameter_active(datum))
+    return NAN;
+  hot = CHART_HOT(datum);
+  return hot->sampled ? hot->last : NAN;
+}
+
+/*
+ * chart_sample -- evaluates the parameters due on this tick and
+ * schedules their next samples.  The two priming samples that are
+ * thrown away are taken on consecutive ticks, whatever the interval.
+ */
+static void
+chart_sample(Chart *chart)
+{
+  GSList *list, *due = wheel_advance(&chart->wheel);
+  gdouble t, now = chart->tick_t ? chart->tick_t : g_get_real_time() / 1e6;
+
+  for (list = due; list != NULL; list = g_slist_next(list))
+    {
+      gdouble val;
+      ChartHot *hot;
+      ChartDatum *datum = ((Wheel_timer *)list->data)->data;
+      gboolean priming = datum->skip > 0;
+
+      if (!CHART_HOT(datum)->active)
+	continue;
+
+      val = datum->user_func(datum->user_data);
+      if (priming)
+	{
+	  datum->skip--;
+	  wheel_add(&chart->wheel, &datum->timer, 1);
+	  continue;
+	}
+
+      hot = CHART_HOT(datum);
+      hot->last = val;
+      hot->last_t = now;
+      if (datum->user_time && (t = datum->user_time(datum->user_data)) > 0)
+	hot->last_t = t;
+      hot->sampled = TRUE;
+      chart_column_add(datum, val);
+      wheel_add(&chart->wheel, &datum->timer,
+	datum->every * adaptive_next(&datum->adapt, val));
+    }
+  g_slist_free(due);
+}
+
+/*
+ * chart_history_take -- gives a new parameter its history and pyramid,
+ * side by side in the chart's arena.
+ */
+static void
+chart_history_take(Chart *chart, ChartDatum *datum)
+{
+  gint k;
+
+  history_arena_take(&chart->arena, &datum->history,
+    chart->default_history_size);
+  memset(datum->pyramid.part, 0, sizeof(datum->pyramid.part));
+  for (k = 0; k < HISTORY_LEVELS; k++)
+    history_arena_take(&chart->arena, &datum->pyramid.level[k],
+      chart->default_history_size);
+}
+
+/*
+ * chart_history_give -- hands a history and pyramid taken by
+ * chart_history_take back to the arena.
+ */
+static void
+chart_history_give(Chart *chart, History *hist, History_pyramid *pyr)
+{
+  gint k;
+
+  history_arena_give(&chart->arena, hist);
+  for (k = 0; k < HISTORY_LEVELS; k++)
+    history_arena_give(&chart->arena, &pyr->level[k]);
+}
+
+const gdouble chart_quantile[CHART_QUANTILES] = { 0.50, 0.95, 0.99 };
+
+static void
+chart_quantiles_new(ChartDatum *datum)
+{
+  gint k;
+  ChartQuantiles *q;
+
+  if (datum->quantiles)
+    return;
+  q = datum->quantiles = g_malloc0(sizeof(*q));
+  sketch_clear(&q->column);
+  sketch_clear(&q->recent);
+  for (k = 0; k < CHART_QUANTILES; k++)
+    history_init(&q->band[k], datum->history.size);
+}
+
+static void
+chart_quantiles_free(ChartDatum *datum)
+{
+  gint k;
+
+  if (datum->quantiles == NULL)
+    return;
+  for (k = 0; k < CHART_QUANTILES; k++)
+    history_free(&datum->quantiles->band[k]);
+  g_free(datum->quantiles);
+  datum->quantiles = NULL;
+}
+
+/*
+ * chart_quantiles_push -- ends a percentile plot's column: pushes its
+ * quantiles to go with the history entry just pushed, and folds its
+ * sketch into the recent one.  A column with no samples holds the
+ * last value, as the history does.
+ */
+static void
+chart_quantiles_push(Chart *chart, ChartDatum *datum, gdouble t)
+{
+  gint k;
+  ChartQuantiles *q = datum->quantiles;
+
+  if (q->column.count == 0)
+    sketch_add(&q->column, CHART_HOT(datum)->last);
+  for (k = 0; k < CHART_QUANTILES; k++)
+    history_push(&q->band[k], t,
+      sketch_quantile(&q->column, chart_quantile[k]));
+  sketch_scale(&q->recent, 1 - 1.0 / MAX(chart->points_in_view, 1));
+  sketch_merge(&q->recent, &q->column);
+  sketch_clear(&q->column);
+}
+
+/*
+ * chart_release_colors -- lets go of a parameter's colors and the GCs
+ * drawn with them.
+ */
+static void
+chart_release_colors(Chart *chart, ChartDatum *datum)
+{
+  gint cnum;
+
+  for (cnum = 0; cnum < datum->colors; cnum++)
+    g_object_unref(datum->gdk_gc[cnum]);
+  if (datum->colors && chart->colormap)
+    gdk_colormap_free_colors(chart->colormap, datum->gdk_color, datum->colors);
+  if (datum->envelope_gc)
+    {
+      g_object_unref(datum->envelope_gc);
+      if (chart->colormap)
+	gdk_colormap_free_colors(chart->colormap, &datum->envelope_color, 1);
+    }
+  g_free(datum->gdk_gc);
+  g_free(datum->gdk_color);
+  datum->colors = 0;
+  datum->gdk_gc = NULL;
+  datum->gdk_color = NULL;
+  datum->envelope_gc = NULL;
+}
+
+/*
+ * chart_parameter_list -- gives a new parameter a slot, reusing one let
+ * go of if there is one, and a place in the page order.
+ */
+static void
+chart_parameter_list(Chart *chart, ChartDatum *datum, gint pageno)
+{
+  gint slot;
+
+  for (slot = 0; slot < chart->slots && chart->hot[slot].datum; slot++)
+    ;
+  if (slot == chart->slot_cap)
+    {
+      chart->slot_cap = MAX(2 * chart->slot_cap, 16);
+      chart->hot = g_renew(ChartHot, chart->hot, chart->slot_cap);
+      chart->order = g_renew(gint, chart->order, chart->slot_cap);
+    }
+  if (slot == chart->slots)
+    chart->slots++;
+
+  memset(&chart->hot[slot], 0, sizeof(chart->hot[slot]));
+  chart->hot[slot].datum = datum;
+  chart->hot[slot].active = TRUE;
+  datum->slot = slot;
+
+  if (pageno < 0 || pageno > chart->params)
+    pageno = chart->params;
+  memmove(&chart->order[pageno + 1], &chart->order[pageno],
+    (chart->params - pageno) * sizeof(*chart->order));
+  chart->order[pageno] = slot;
+  chart->params++;
+}
+
+/*
+ * chart_parameter_unlist -- lets go of a parameter that has scrolled
+ * off: its slot is free for the next one added.
+ */
+static void
+chart_parameter_unlist(Chart *chart, ChartDatum *datum)
+{
+  gint i;
+
+  for (i = 0; chart->order[i] != datum->slot; i++)
+    ;
+  chart->params--;
+  memmove(&chart->order[i], &chart->order[i + 1],
+    (chart->params - i) * sizeof(*chart->order));
+
+  chart->hot[datum->slot].datum = NULL;
+  while (chart->slots && chart->hot[chart->slots - 1].datum == NULL)
+    chart->slots--;
+  datum->slot = -1;
+}
+
+static void
+chart_parameter_free(Chart *chart, ChartDatum *datum)
+{
+  chart_parameter_deactivate(chart, datum);
+  history_window_free(&datum->window);
+  if (datum->map)
+    {
+      history_free(&datum->history);
+      history_pyramid_free(&datum->pyramid);
+      history_map_close(datum->map);
+    }
+  else
+    chart_history_give(chart, &datum->history, &datum->pyramid);
+  if (datum->archive)
+    history_pack_free(datum->archive);
+  chart_quantiles_free(datum);
+  chart_release_colors(chart, datum);
+  g_free(datum->color_names);
+  g_free(datum->own_adj);
+  g_free(datum);
+}
+
+/*
+ * chart_parameter_ref -- keeps a parameter from being freed once it's
+ * been deactivated and has scrolled off.  A new parameter comes with
+ * one reference for the caller, besides the chart's own.
+ */
+ChartDatum *
+chart_parameter_ref(ChartDatum *datum)
+{
+  datum->refs++;
+  return datum;
+}
+
+void
+chart_parameter_unref(ChartDatum *datum)
+{
+  if (--datum->refs == 0)
+    chart_parameter_free(datum->chart, datum);
+}
+
+/* Bytes per column of a history and its pyramid. */
+#define CHART_COLUMN_BYTES \
+  ((1 + HISTORY_LEVELS) * (sizeof(gdouble) + 3 * sizeof(gfloat)))
+#define CHART_HISTORY_MIN 16	/* columns, however tight the budget */
+
+/*
+ * chart_rebalance -- shares the chart's history budget among its
+ * active parameters by weight, resizing their histories and pyramids
+ * and keeping the newest columns.  Persistent histories are the size
+ * of their files and come off the top.  With no budget, every
+ * parameter gets default_history_size columns.
+ */
+static void
+chart_rebalance(Chart *chart)
+{
+  gint i, k;
+  gdouble weights = 0, budget = chart->history_budget;
+
+  chart->rebalance = FALSE;
+  for (i = 0; i < chart->slots; i++)
+    {
+      ChartDatum *datum = chart->hot[i].datum;
+
+      if (datum == NULL || !chart->hot[i].active)
+	continue;
+      if (datum->map)
+	budget -= (gdouble)datum->history.size * CHART_COLUMN_BYTES;
+      else
+	weights += datum->weight;
+    }
+
+  for (i = 0; i < chart->slots; i++)
+    {
+      ChartDatum *datum = chart->hot[i].datum;
+      gint size = chart->default_history_size;
+
+      if (datum == NULL || !chart->hot[i].active || datum->map)
+	continue;
+      if (chart->history_budget)
+	{
+	  gdouble columns = weights > 0 ?
+	    MAX(budget, 0) * datum->weight / weights / CHART_COLUMN_BYTES : 0;
+	  size = MAX(MIN(columns, G_MAXINT / 2), CHART_HISTORY_MIN);
+	}
+      if (size == datum->history.size)
+	continue;
+      history_resize(&datum->history, size, &chart->arena);
+      history_pyramid_resize(&datum->pyramid, size, &chart->arena);
+      if (datum->quantiles)
+	for (k = 0; k < CHART_QUANTILES; k++)
+	  history_resize(&datum->quantiles->band[k], size, NULL);
+    }
+}
+
+/*
+ * chart_parameter_bytes -- what a parameter's history, pyramid,
+ * window and archive take up.
+ */
+gsize
+chart_parameter_bytes(const ChartDatum *datum)
+{
+  gsize bytes = (gsize)datum->history.size * CHART_COLUMN_BYTES;
+
+  bytes += 2 * datum->window.cap * sizeof(*datum->window.lo);
+  if (datum->archive)
+    bytes += history_pack_bytes(datum->archive);
+  if (datum->quantiles)
+    bytes += sizeof(*datum->quantiles) + CHART_QUANTILES
+      * (gsize)datum->quantiles->band[0].size * (sizeof(gdouble) + 3 * sizeof(gfloat));
+  return bytes;
 }
 
 static gint
 chart_timer(Chart *chart)
 {
-  gint rescale = 0;
-  GSList *list, *next;
+  gint i, rescale = 0;
+  gint64 now;
+  gdouble col_t;
 
   g_signal_emit_by_name(G_OBJECT(chart), "chart_pre_update", NULL);
+  chart_sample(chart);
+  g_signal_emit_by_name(G_OBJECT(chart), "chart_sampled", NULL);
 
-  for (list = chart->param; list != NULL; list = g_slist_next(list))
+  /* Samples pile up in each parameter's column until there are enough
+     of them to push a column and scroll. */
+  if (++chart->column_phase < chart->column_ticks)
+    return TRUE;
+  chart->column_phase = 0;
+  now = g_get_monotonic_time();
+  col_t = chart->tick_t ? chart->tick_t : g_get_real_time() / 1e6;
+  if (chart->rebalance)
+    chart_rebalance(chart);
+
+  for (i = 0; i < chart->slots; i++)
     {
-      gdouble val;
-      ChartDatum *datum = list->data;
+      gdouble val, t;
+      ChartHot *hot = &chart->hot[i];
+      ChartDatum *datum = hot->datum;
 
-      if (!datum->active)
+      if (datum == NULL)
+	continue;
+
+      if (!hot->active)
 	{
-	  datum->idle++;
-	  if (datum->history_size <= datum->history_count + datum->idle)
-	    datum->history_count--;
-	  if (datum->history_count == 0)
+	  hot->idle++;
+	  if (datum->history.size <= datum->history.count + hot->idle)
+	    datum->history.count--;
+	  if (datum->history.count == 0)
 	    {
 	      #ifdef DEBUG
-	      printf("timer: deleting: chart %p, param %p, datum %p\n",
-		chart, chart->param, datum);
+	      printf("timer: deleting: chart %p, slot %d, datum %p\n",
+		chart, i, datum);
 	      #endif
-	      next = g_slist_next(list);
-	      chart->param = g_slist_remove(chart->param, datum);
-	      g_free(datum);
-	      list = next;
+	      chart_parameter_unlist(chart, datum);
+	      chart_parameter_unref(datum);
 	    }
 	  continue;
 	}
 
-      val = datum->user_func(datum->user_data);
-
-      if (datum->skip)
-	{
-	  datum->skip--;
-	  continue;
-	}
+      if (!hot->sampled)
+	continue;
 
 #ifdef DEBUG
-/* printf("timer: value %p = %f\n", datum, val); */
+/* printf("timer: value %p = %f\n", datum, hot->last); */
 #endif
 
-      if (datum->history_count < datum->history_size)
-	datum->history_count++;
-      if (++datum->newest >= datum->history_size)
-	datum->newest = 0;
-
-      datum->history[datum->newest] = val;
-
-      if (datum->rescale)
+      /* A column with no samples of its own holds the last value, but
+	 at the column's time, not the sample's: time mustn't stand still
+	 in the history, the archive, or whatever reads them back. */
+      if (hot->col_n)
 	{
-	  gint view = chart->points_in_view;
-	  gint idle = datum->idle;
-	  gint data = datum->history_count;
-	  gint n = MIN(data, view - idle);
+	  t = hot->last_t;
+	  val = hot->col_sum / hot->col_n;
+	  history_push_range(&datum->history, t,
+	    val, hot->col_min, hot->col_max);
+	  hot->col_n = 0;
+	  hot->col_sum = 0;
+	}
+      else
+	{
+	  t = MAX(col_t, hot->last_t);
+	  history_push(&datum->history, t, hot->last);
+	}
+      history_pyramid_push(&datum->pyramid, &datum->history);
+      if (datum->archive)
+	history_pack_push(datum->archive, t,
+	  datum->history.values[datum->history.newest]);
+      if (datum->quantiles)
+	chart_quantiles_push(chart, datum, t);
 
-	  gint h = datum->newest;
-	  datum->min = datum->max = datum->history[h];
+      if (hot->rescale)
+	{
+	  gint h = datum->history.newest;
 
-	  while (n-- > 0)
+	  history_window_update(&datum->window, &datum->history,
+	    chart->points_in_view - hot->idle);
+	  if (!history_window_range(&datum->window, &datum->history,
+	      &datum->min, &datum->max))
 	    {
-	      gfloat x = datum->history[h];
-	      if (!isfinite(datum->min))
-		datum->min = datum->max = x;
-	      else if (x < datum->min && isfinite(x))
-		datum->min = x;
-	      else if (datum->max < x && isfinite(x))
-		datum->max = x;
-	      if (--h < 0)
-		h = datum->history_size - 1;
+	      datum->min = datum->history.mins[h];
+	      datum->max = datum->history.maxs[h];
 	    }
-	  rescale += chart_rescale_range(datum);
+	  if (isfinite(datum->min) && isfinite(datum->max))
+	    rescale += chart_rescale_range(chart, datum, now);
 	}
+
+      if (datum->map)
+	history_map_sync(datum->map, &datum->history, &datum->pyramid,
+	  datum->adj->lower, datum->adj->upper);
     }
 
   if (rescale)
-    g_signal_emit_by_name(G_OBJECT(chart), "chart_rescale", NULL);
+    {
+      chart->rescales += rescale;
+      g_signal_emit_by_name(G_OBJECT(chart), "chart_rescale", NULL);
+    }
   g_signal_emit_by_name(G_OBJECT(chart), "chart_post_update", NULL);
 
   return TRUE;
 }
 
+/*
+ * chart_set_interval -- an interval of zero stops the chart's own
+ * timer, leaving chart_tick to whoever is feeding it.
+ */
 void
 chart_set_interval(Chart *chart, guint msec)
 {
   if (chart->timer)
     g_source_remove(chart->timer);
-  chart->timer = g_timeout_add(msec, (GtkFunction)chart_timer, chart);
+  chart->interval = msec;
+  chart->timer = msec ?
+    tick_add(msec, chart->align, (GSourceFunc)chart_timer, chart) : 0;
+}
+
+/*
+ * chart_set_align -- keeps ticks on multiples of the interval in
+ * wall-clock time, so that charts on different hosts line up.
+ */
+void
+chart_set_align(Chart *chart, gboolean align)
+{
+  chart->align = align;
+  if (chart->timer)
+    chart_set_interval(chart, chart->interval);
+}
+
+/*
+ * chart_set_column_ticks -- reduces every so many ticks' samples into
+ * one history column, so that sampling can run faster than the chart
+ * scrolls.  Each column keeps the samples' mean, minimum and maximum.
+ */
+void
+chart_set_column_ticks(Chart *chart, gint ticks)
+{
+  chart->column_ticks = MAX(ticks, 1);
+  chart->column_phase = 0;
+}
+
+/*
+ * chart_set_hysteresis -- holds autoranged bounds back from shrinking
+ * until the data has pulled away from them by the given fraction of
+ * the range, for at least hold milliseconds.  Zero for both rescales
+ * as soon as the data allows.
+ */
+void
+chart_set_hysteresis(Chart *chart, gdouble fraction, gint hold)
+{
+  chart->hysteresis = CLAMP(fraction, 0, 1);
+  chart->hold = MAX(hold, 0);
+}
+
+void
+chart_tick(Chart *chart)
+{
+  chart_timer(chart);
+}
+
+/*
+ * chart_tick_at -- steps the chart as though the time were t, for
+ * samples taken some time ago.
+ */
+void
+chart_tick_at(Chart *chart, gdouble t)
+{
+  chart->tick_t = t;
+  chart_timer(chart);
+  chart->tick_t = 0;
+}
+
+/*
+ * chart_set_history_dir -- keeps the histories of parameters made
+ * persistent with chart_parameter_persist in files under dir.  NULL
+ * keeps them in memory only.
+ */
+void
+chart_set_history_dir(Chart *chart, const gchar *dir)
+{
+  g_free(chart->history_dir);
+  chart->history_dir = g_strdup(dir);
+}
+
+/*
+ * chart_set_retain -- has parameters added from now on archive their
+ * columns, compressed, until they have the given number of them; zero
+ * archives nothing.
+ */
+void
+chart_set_retain(Chart *chart, guint64 columns)
+{
+  chart->retain = columns;
+}
+
+/*
+ * chart_parameter_persist -- moves a new parameter's history into a
+ * file under the chart's history directory, named for key, and picks
+ * up whatever an earlier run left there along with the scale it was
+ * drawn to.  The time the chart wasn't running is marked with a gap.
+ * Returns FALSE, leaving the history in memory, if there's no
+ * directory or the file can't be had.
+ *
+ * A parameter that's been edited without changing its key is being
+ * replaced by the new one, which takes over its history and file.
+ */
+gboolean
+chart_parameter_persist(ChartDatum *datum, const gchar *key)
+{
+  Chart *chart = datum->chart;
+  gint i;
+  History hist;
+  History_pyramid pyr;
+  gdouble lower, upper;
+
+  if (chart->history_dir == NULL || datum->map)
+    return FALSE;
+
+  for (i = 0; i < chart->slots; i++)
+    {
+      ChartDatum *old = chart->hot[i].datum;
+
+      if (old && old != datum && old->map
+	&& strcmp(history_map_key(old->map), key) == 0)
+	{
+	  History_pack *archive = datum->archive;
+
+	  hist = datum->history;
+	  pyr = datum->pyramid;
+
+	  datum->history = old->history;
+	  datum->pyramid = old->pyramid;
+	  datum->archive = old->archive;
+	  datum->map = old->map;
+	  old->history = hist;
+	  old->pyramid = pyr;
+	  old->archive = archive;
+	  old->map = NULL;
+	  datum->adj->lower = old->adj->lower;
+	  datum->adj->upper = old->adj->upper;
+	  return TRUE;
+	}
+    }
+  hist = datum->history;
+  pyr = datum->pyramid;
+  datum->map = history_map_open(chart->history_dir, key,
+    chart->default_history_size, &datum->history, &datum->pyramid);
+  if (datum->map == NULL)
+    return FALSE;
+  chart_history_give(chart, &hist, &pyr);
+  chart->rebalance = TRUE;
+
+  if (history_map_restored(datum->map, &lower, &upper))
+    {
+      if (isfinite(lower) && isfinite(upper))
+	{
+	  datum->adj->lower = lower;
+	  datum->adj->upper = upper;
+	}
+      history_push(&datum->history, g_get_real_time() / 1e6, NAN);
+      history_pyramid_push(&datum->pyramid, &datum->history);
+    }
+  return TRUE;
+}
+
+/*
+ * chart_parameter_backfill -- seeds a parameter's history with values
+ * sampled elsewhere, oldest first, as though they had been plotted.
+ */
+void
+chart_parameter_backfill(ChartDatum *datum,
+  const gdouble *times, const gfloat *values, gint n)
+{
+  gint i;
+
+  for (i = 0; i < n; i++)
+    {
+      history_push(&datum->history, times[i], values[i]);
+      history_pyramid_push(&datum->pyramid, &datum->history);
+      if (datum->archive)
+	history_pack_push(datum->archive, times[i], values[i]);
+    }
+  datum->skip = 0;
 }
 
 ChartDatum *
@@ -261,18 +937,23 @@ chart_parameter_add(Chart *chart,
   datum->chart = chart;
   datum->user_func = user_func;
   datum->user_data = user_data;
-  datum->rescale = FALSE;
-  datum->active = TRUE;
-  datum->idle = datum->newest = datum->history_count = 0;
+  datum->user_time = NULL;
+  datum->user_free = NULL;
+  datum->refs = 2;
+  datum->weight = 1;
+  datum->shrink_since[0] = datum->shrink_since[1] = 0;
+  datum->map = NULL;
+  datum->archive = chart->retain ? history_pack_new(chart->retain) : NULL;
 
   datum->top_max = top_max;
   datum->bot_max = bot_max;
   datum->top_min = top_min;
   datum->bot_min = bot_min;
 
+  datum->own_adj = NULL;
   if (adj == NULL)
   {
-    adj = g_malloc(sizeof(*adj));
+    adj = datum->own_adj = g_malloc(sizeof(*adj));
     adj->upper = datum->top_min;
     adj->lower = datum->bot_max;
   }
@@ -287,18 +968,148 @@ chart_parameter_add(Chart *chart,
   datum->color_names = g_strdup(color_names);
   datum->gdk_gc = NULL;
   datum->gdk_color = NULL;
-  chart->param = g_slist_insert(chart->param, datum, pageno);
+  datum->envelope_gc = NULL;
+  chart_parameter_list(chart, datum, pageno);
 
   datum->plot_style = chart->default_plot_style;
   datum->scale_style = chart->default_scale_style;
 
   datum->skip = 2;
-  datum->history_size = chart->default_history_size;
-  datum->history = g_malloc(datum->history_size * sizeof(*datum->history));
+  datum->every = 1;
+  adaptive_init(&datum->adapt, NULL);
+  datum->quantiles = NULL;
+  datum->timer.data = datum;
+  wheel_add(&chart->wheel, &datum->timer, 1);
+  chart_history_take(chart, datum);
+  history_window_init(&datum->window);
+  chart->rebalance = TRUE;
 
   return datum;
 }
 
+/*
+ * ChartSeries -- a parameter whose values are pushed in by some other
+ * thread rather than pulled by user_func.  Each series has a single
+ * producer and a fixed-size, lock-free ring between it and the main
+ * loop; chart_timer drains the ring once a tick.
+ */
+struct _ChartSeries
+{
+  ChartDatum *datum;
+  guint size;			/* a power of two */
+  guint head;			/* written only by the producer */
+  guint tail;			/* written only by the main loop */
+  guint dropped;
+  gdouble last, last_t;
+  gboolean fresh;		/* last came in on this tick */
+  struct { gdouble t, value; } *slot;
+};
+
+/*
+ * chart_series_drain -- the user_func of a pushed series.  Takes
+ * everything queued since the last tick: all of it goes into the
+ * column's mean, envelope and percentiles, and the newest is the value
+ * sampled, at the time it was pushed with.  With nothing queued the
+ * previous value is held.
+ */
+static gdouble
+chart_series_drain(ChartSeries *series)
+{
+  guint tail = series->tail;
+  guint head = __atomic_load_n(&series->head, __ATOMIC_ACQUIRE);
+
+  series->fresh = head != tail;
+  if (head != tail)
+    {
+      guint newest = (head - 1) & (series->size - 1);
+
+      /* All but the newest, which chart_sample adds itself. */
+      if (series->datum->skip == 0)
+	for (; tail != head - 1; tail++)
+	  chart_column_add(series->datum,
+	    series->slot[tail & (series->size - 1)].value);
+      series->last = series->slot[newest].value;
+      series->last_t = series->slot[newest].t;
+      __atomic_store_n(&series->tail, head, __ATOMIC_RELEASE);
+    }
+  return series->last;
+}
+
+/*
+ * chart_series_time -- the user_time of a pushed series: when its
+ * newest sample was taken, if one came in this tick.
+ */
+static gdouble
+chart_series_time(ChartSeries *series)
+{
+  return series->fresh ? series->last_t : 0;
+}
+
+ChartSeries *
+chart_series_add(Chart *chart, guint queue_size,
+  const gchar *color_names, ChartAdjustment *adj, int pageno,
+  gdouble bot_min, gdouble bot_max, gdouble top_min, gdouble top_max)
+{
+  ChartSeries *series = g_malloc0(sizeof(*series));
+
+  for (series->size = 1; series->size < queue_size; series->size <<= 1)
+    ;
+  series->slot = g_malloc(series->size * sizeof(*series->slot));
+  series->datum = chart_parameter_add(chart,
+    chart_series_drain, series, color_names, adj, pageno,
+    bot_min, bot_max, top_min, top_max);
+  chart_set_user_time(series->datum, (gdouble (*)(void *))chart_series_time);
+  return series;
+}
+
+ChartDatum *
+chart_series_datum(ChartSeries *series)
+{
+  return series->datum;
+}
+
+/*
+ * chart_series_push -- queues a sample from the series' producer
+ * thread without locking.  If the main loop has fallen a whole queue
+ * behind, the sample is dropped and counted, and FALSE is returned.
+ */
+gboolean
+chart_series_push(ChartSeries *series, gdouble t, gdouble value)
+{
+  guint head = series->head;
+  guint tail = __atomic_load_n(&series->tail, __ATOMIC_ACQUIRE);
+
+  if (head - tail >= series->size)
+    {
+      __atomic_add_fetch(&series->dropped, 1, __ATOMIC_RELAXED);
+      return FALSE;
+    }
+
+  series->slot[head & (series->size - 1)].t = t;
+  series->slot[head & (series->size - 1)].value = value;
+  __atomic_store_n(&series->head, head + 1, __ATOMIC_RELEASE);
+  return TRUE;
+}
+
+guint
+chart_series_dropped(ChartSeries *series)
+{
+  return __atomic_load_n(&series->dropped, __ATOMIC_RELAXED);
+}
+
+/*
+ * chart_series_remove -- retires a pushed series.  Its producer must
+ * have stopped pushing first.
+ */
+void
+chart_series_remove(Chart *chart, ChartSeries *series)
+{
+  chart_parameter_deactivate(chart, series->datum);
+  chart_parameter_unref(series->datum);
+  g_free(series->slot);
+  g_free(series);
+}
+
 void
 chart_set_top_max(ChartDatum *datum, double top_max)
 {
@@ -323,10 +1134,75 @@ chart_set_bot_min(ChartDatum *datum, double bot_min)
   datum->bot_min = bot_min;
 }
 
+/*
+ * chart_set_every -- samples the parameter only every so many ticks,
+ * holding its last value in between.
+ */
+void
+chart_set_every(ChartDatum *datum, gint ticks)
+{
+  datum->every = MAX(ticks, 1);
+}
+
+/*
+ * chart_set_adaptive -- lets the parameter's interval stretch while its
+ * value stays flat; see Adaptive.
+ */
+void
+chart_set_adaptive(ChartDatum *datum, const char *spec)
+{
+  adaptive_init(&datum->adapt, spec);
+}
+
+/*
+ * chart_set_history_budget -- caps the bytes that all the chart's
+ * parameters' histories take, sharing them out by weight; zero gives
+ * every parameter default_history_size columns instead.
+ */
+void
+chart_set_history_budget(Chart *chart, gsize bytes)
+{
+  chart->history_budget = bytes;
+  chart->rebalance = TRUE;
+}
+
+/*
+ * chart_set_weight -- the parameter's share of the history budget,
+ * relative to the others'.
+ */
+void
+chart_set_weight(ChartDatum *datum, gdouble weight)
+{
+  datum->weight = MAX(weight, 0);
+  datum->chart->rebalance = TRUE;
+}
+
+/*
+ * chart_set_user_free -- has user_data freed with user_free when the
+ * parameter is deactivated.
+ */
+void
+chart_set_user_free(ChartDatum *datum, GDestroyNotify user_free)
+{
+  datum->user_free = user_free;
+}
+
+/*
+ * chart_set_user_time -- has each sample stamped with the time
+ * user_time gives, for sources that know when their values were taken.
+ * A time of 0 means now.
+ */
+void
+chart_set_user_time(ChartDatum *datum, gdouble (*user_time)(void *user_data))
+{
+  datum->user_time = user_time;
+}
+
 void
 chart_set_autorange(ChartDatum *datum, gboolean rescale)
 {
-  datum->rescale = rescale;
+  if (datum->slot >= 0)
+    CHART_HOT(datum)->rescale = rescale;
 }
 
 void
@@ -335,10 +1211,18 @@ chart_set_scale_style(ChartDatum *datum, ChartScaleStyle scale_style)
   datum->scale_style = scale_style;
 }
 
+/*
+ * chart_set_plot_style -- a percentile plot starts keeping quantiles
+ * from here on; any other style stops.
+ */
 void
 chart_set_plot_style(ChartDatum *datum, ChartPlotStyle plot_style)
 {
   datum->plot_style = plot_style;
+  if (plot_style == chart_plot_percentile)
+    chart_quantiles_new(datum);
+  else
+    chart_quantiles_free(datum);
 }
 
 void
@@ -347,10 +1231,10 @@ chart_assign_color(Chart *chart, ChartDatum *datum)
   gchar *names, *color = NULL;
   static const gchar *whitespace = " \t\r\n";
   GdkColor default_fg = GTK_WIDGET(chart)->style->fg[GTK_WIDGET_STATE(chart)];
+  GdkColor bg = GTK_WIDGET(chart)->style->bg[GTK_WIDGET_STATE(chart)];
+  GdkColor envelope;
 
-  datum->colors = 0;
-  datum->gdk_gc = NULL;
-  datum->gdk_color = NULL;
+  chart_release_colors(chart, datum);
 
   names = g_strdup(datum->color_names);
   do
@@ -374,6 +1258,15 @@ chart_assign_color(Chart *chart, ChartDatum *datum)
     }
   while (color != NULL);
   g_free(names);
+
+  envelope = datum->gdk_color[0];
+  envelope.red = (envelope.red + bg.red) / 2;
+  envelope.green = (envelope.green + bg.green) / 2;
+  envelope.blue = (envelope.blue + bg.blue) / 2;
+  gdk_colormap_alloc_color(chart->colormap, &envelope, FALSE, TRUE);
+  datum->envelope_color = envelope;
+  datum->envelope_gc = gdk_gc_new(GTK_WIDGET(chart)->window);
+  gdk_gc_set_foreground(datum->envelope_gc, &envelope);
 }
 
 /*
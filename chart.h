@@ -22,6 +22,12 @@
 #include <gtk/gtk.h>
 #include <gtk/gtkdrawingarea.h>
 
+#include "history.h"
+#include "histmap.h"
+#include "histpack.h"
+#include "sketch.h"
+#include "wheel.h"
+
 #define TYPE_CHART			(chart_get_type())
 #define CHART(obj) 			(G_TYPE_CHECK_INSTANCE_CAST((obj), TYPE_CHART, Chart))
 #define IS_CHART(obj) 			(G_TYPE_CHECK_INSTANCE_TYPE((obj), TYPE_CHART))
@@ -32,6 +38,7 @@ typedef struct _Chart		Chart;
 typedef struct _ChartClass	ChartClass;
 typedef struct _ChartDatum	ChartDatum;
 typedef struct _ChartAdjustment	ChartAdjustment;
+typedef struct _ChartSeries	ChartSeries;
 
 typedef enum
 {
@@ -45,10 +52,33 @@ typedef enum
   chart_plot_point,
   chart_plot_line,
   chart_plot_solid,
+  chart_plot_percentile,
   chart_plot_indicator
 }
 ChartPlotStyle; /* FIX THIS: should be in strip.h */
 
+/*
+ * ChartHot -- what the per-tick and per-column loops touch of each
+ * parameter, kept in one array on the chart so that those loops walk
+ * contiguous memory and pass over idle parameters without touching
+ * them.  A parameter's slot, its index there, is fixed for as long as
+ * the chart lists it, and is reused once it's let go; the array moves
+ * as it grows, so hold on to the slot, never a pointer into it.
+ */
+typedef struct
+{
+  ChartDatum *datum;	/* NULL for a free slot */
+  gboolean active, sampled, rescale;
+  gint idle;
+  gint col_n;		/* samples so far in this column */
+  gdouble col_sum, col_min, col_max;
+  gdouble last, last_t;	/* held between samples */
+}
+ChartHot;
+
+#define CHART_HOT(datum)	(&(datum)->chart->hot[(datum)->slot])
+#define CHART_PARAM(chart, i)	((chart)->hot[(chart)->order[i]].datum)
+
 struct _Chart
 {
   GtkDrawingArea drawing;
@@ -61,13 +91,32 @@ struct _Chart
   ChartScaleStyle default_scale_style;
 
   GdkColormap *colormap;
-  GSList *param;
+  ChartHot *hot;	/* listed parameters' hot state, by slot */
+  gint slots, slot_cap;	/* in hot: up to the last in use, and allocated */
+  gint *order;		/* their slots in page order, for drawing */
+  gint params;		/* in order */
+  guint interval;
+  gboolean align;	/* ticks fall on multiples of interval */
+  gint column_ticks;	/* ticks reduced into each history column */
+  gint column_phase;
+  gdouble tick_t;	/* of a tick being replayed, else 0 for now */
+  gboolean obscured;	/* by other windows, as of the last visibility-notify */
+  Wheel wheel;		/* of parameters' next samples, in ticks */
+  gdouble hysteresis;	/* of the range a bound must clear to shrink */
+  gint hold;		/* ms a bound must stay shrinkable first */
+  guint rescales;	/* bound changes, for tuning the above */
+  gchar *history_dir;	/* where parameters' histories persist, if anywhere */
+  guint64 retain;	/* columns each parameter's archive keeps; 0 for none */
+  History_arena arena;	/* parameters' histories and pyramids */
+  gsize history_budget;	/* bytes for them all; 0 for default_history_size each */
+  gboolean rebalance;	/* parameters or weights have changed since */
 };
 
 struct _ChartClass
 {
   GtkDrawingAreaClass parent_class;
   void (*chart_pre_update)  (Chart *chart);
+  void (*chart_sampled)	    (Chart *chart); /* every tick, not just columns */
   void (*chart_post_update) (Chart *chart);
   void (*chart_rescale)	    (Chart *chart);
 };
@@ -77,34 +126,81 @@ struct _ChartAdjustment
   gdouble lower, upper;
 };
 
-struct _ChartDatum
-{
-  Chart *chart;
+#define CHART_QUANTILES	3	/* p50, p95 and p99 */
 
-  gint history_size, history_count, active, idle, newest, skip;
-  gfloat *history;
+extern const gdouble chart_quantile[CHART_QUANTILES];
 
-  gdouble max, min; /* of current window's worth of history values */
-  gdouble top_max, top_min;
-  gdouble bot_max, bot_min; /* Adjustment limits */
-  gboolean rescale;
+/*
+ * ChartQuantiles -- what a percentile plot keeps: a sketch of the
+ * samples in the column being filled, one of recent columns decaying
+ * over about a chart's width, and rings of each column's quantiles
+ * that scroll alongside its history.
+ */
+typedef struct
+{
+  Sketch column, recent;
+  History band[CHART_QUANTILES];
+}
+ChartQuantiles;
+
+/*
+ * ChartDatum -- a parameter.  What every tick touches is in its
+ * ChartHot slot; of the rest, fields a sampled column touches, to push
+ * its value and draw it, come first so that they share a cache line or
+ * two, those touched only when it's sampled come next, and the rest,
+ * touched now and then, last.
+ */
+struct _ChartDatum
+{
+  gint slot;		/* in chart->hot while listed, else -1 */
+  History history;
   ChartAdjustment *adj; /* Adjustement */
+  gdouble max, min; /* of current window's worth of history values */
+  ChartScaleStyle scale_style;
+  ChartPlotStyle plot_style; /* FIX THIS: only strips have plot_styles */
+  GdkGC **gdk_gc;
+  GdkGC *envelope_gc;	/* the min-max range, paler than gdk_gc[0] */
+  GdkColor envelope_color; /* of envelope_gc, allocated in the colormap */
 
+  gint skip;
+  gint every;		/* ticks between samples */
   gdouble (*user_func)(void *user_data);
+  gdouble (*user_time)(void *user_data); /* when user_func's value was taken */
   void *user_data;
+  Adaptive adapt;	/* stretches every while the value is flat */
+  ChartQuantiles *quantiles; /* for percentile plots */
+  Wheel_timer timer;
+
+  History_pyramid pyramid; /* of history, for zooming out */
+  History_map *map;	/* holding both, if they persist */
+  History_pack *archive; /* of columns long since scrolled away */
+  History_window window; /* keeps max and min up to date */
+  gdouble top_max, top_min;
+  gdouble bot_max, bot_min; /* Adjustment limits */
+  gint64 shrink_since[2]; /* when upper, lower first could have shrunk */
+  gdouble weight;	/* its share of the chart's history budget */
 
-  ChartScaleStyle scale_style;
-  ChartPlotStyle plot_style; /* FIX THIS: only strips have plot_styles */
-
+  Chart *chart;
+  gint refs;		/* the chart's, while it's listed, and holders' */
+  GDestroyNotify user_free; /* of user_data, once it's deactivated */
+  ChartAdjustment *own_adj; /* adj, if the chart made it */
   gchar *color_names;
   gint colors;
-  GdkGC **gdk_gc;
   GdkColor *gdk_color;
 };
 
 GType chart_get_type(void);
 
 void chart_set_interval(Chart *chart, guint msec);
+void chart_set_align(Chart *chart, gboolean align);
+void chart_set_column_ticks(Chart *chart, gint ticks);
+void chart_set_hysteresis(Chart *chart, gdouble fraction, gint hold);
+void chart_set_history_dir(Chart *chart, const gchar *dir);
+void chart_set_retain(Chart *chart, guint64 columns);
+void chart_set_history_budget(Chart *chart, gsize bytes);
+void chart_tick(Chart *chart);
+void chart_tick_at(Chart *chart, gdouble t);
+gboolean chart_viewable(Chart *chart);
 
 ChartDatum *chart_parameter_add(Chart *chart,
   gdouble (*func)(), gpointer user_data,
@@ -112,8 +208,30 @@ ChartDatum *chart_parameter_add(Chart *chart,
   gdouble bot_min, gdouble bot_max, gdouble top_min, gdouble top_max);
 
 void chart_parameter_deactivate(Chart *chart, ChartDatum *param);
+ChartDatum *chart_parameter_ref(ChartDatum *datum);
+void chart_parameter_unref(ChartDatum *datum);
+void chart_parameter_fold(ChartDatum *datum, gdouble val);
+gboolean chart_parameter_active(const ChartDatum *datum);
+gdouble chart_parameter_value(const ChartDatum *datum);
+gboolean chart_parameter_persist(ChartDatum *datum, const gchar *key);
+void chart_parameter_backfill(ChartDatum *datum,
+  const gdouble *times, const gfloat *values, gint n);
+
+ChartSeries *chart_series_add(Chart *chart, guint queue_size,
+  const gchar *color_name, ChartAdjustment *adj, int pageno,
+  gdouble bot_min, gdouble bot_max, gdouble top_min, gdouble top_max);
+ChartDatum *chart_series_datum(ChartSeries *series);
+gboolean chart_series_push(ChartSeries *series, gdouble t, gdouble value);
+guint chart_series_dropped(ChartSeries *series);
+void chart_series_remove(Chart *chart, ChartSeries *series);
 
 void chart_set_autorange(ChartDatum *param, gboolean rescale);
+void chart_set_every(ChartDatum *datum, gint ticks);
+void chart_set_adaptive(ChartDatum *datum, const char *spec);
+void chart_set_user_free(ChartDatum *datum, GDestroyNotify user_free);
+void chart_set_user_time(ChartDatum *datum, gdouble (*user_time)(void *user_data));
+void chart_set_weight(ChartDatum *datum, gdouble weight);
+gsize chart_parameter_bytes(const ChartDatum *datum);
 
 void chart_set_top_min(ChartDatum *datum, gdouble top_min);
 void chart_set_top_max(ChartDatum *datum, gdouble top_max);
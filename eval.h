@@ -20,8 +20,16 @@
 
 void chart_start(GtkWidget *chart, Param_group *pg);
 
+ChartDatum *chart_desc_add(Chart *chart,
+  gdouble (*user_func)(), gpointer user_data,
+  const Param_desc *desc, ChartAdjustment *adj, int pageno, int rescale);
 ChartDatum *chart_equation_add(Chart *chart,
   Param_group *pg, const Param_desc *desc, ChartAdjustment *adj,
   int pageno, int rescale);
 
+int profile_edits(const char *fn, int edits);
+
+ChartPlotStyle str_to_plot_style(const char *style_name);
+ChartScaleStyle str_to_scale_style(const char *style_name);
+
 #endif /* EVAL_H */
@@ -0,0 +1,71 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef EXPR_H
+#define EXPR_H
+
+#include <sys/time.h>
+
+#include "ingest.h"
+#include "push.h"
+
+#ifdef HAVE_LIBGTOP
+#include <glibtop.h>
+#include <glibtop/union.h>
+#endif
+
+#ifdef HAVE_LIBGTOP
+typedef struct
+{
+  glibtop_cpu     cpu;
+  glibtop_mem     mem;
+  glibtop_swap    swap;
+  glibtop_uptime  uptime;
+  glibtop_loadavg loadavg;
+  glibtop_netload netload;
+}
+Gtop;
+#endif /* HAVE_LIBGTOP */
+
+struct _Param_group
+{
+  int interval;
+  int column;			/* ms per chart column; 0 is one per interval */
+  int visible;
+  double filter;
+  int align;			/* ticks on multiples of interval */
+  struct timeval t_now;		/* of the current pass */
+#ifdef HAVE_LIBGTOP
+  int gtop_cpu, gtop_mem, gtop_swap, gtop_uptime, gtop_load, gtop_net;
+  Gtop gtop_last, gtop_now;
+#endif
+};
+typedef struct _Param_group Param_group;
+
+typedef struct _Expr Expr;
+
+Expr *expr_compile(Param_group *pg, const Param_desc *desc);
+gdouble evaluate_equation(Expr *expr);
+gdouble expr_time(Expr *expr);
+void expr_set_fold(Expr *expr, void (*fold)(gpointer data, gdouble val),
+  gpointer data);
+void free_expr(Expr *expr);
+unsigned long expr_forks(const Expr *expr);
+
+void param_group_tick(Param_group *pg);
+
+#endif /* EXPR_H */
@@ -0,0 +1,237 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "histmap.h"
+
+extern char *prog_name;
+
+#define HISTORY_MAP_MAGIC	"SCHIST1"
+#define HISTORY_MAP_HEADER	4096	/* bytes, including the key */
+#define HISTORY_MAP_RINGS	(1 + HISTORY_LEVELS)
+
+typedef struct
+{
+  char magic[8];
+  guint32 size, rings;
+  gdouble lower, upper;		/* autoscale, as of the last sync */
+  struct
+  {
+    gint32 count, newest;
+    guint64 pushed;
+  }
+  ring[HISTORY_MAP_RINGS];
+  History_rollup part[HISTORY_LEVELS];
+  guint32 keylen;
+  char key[];
+}
+History_map_header;
+
+struct _History_map
+{
+  int fd;
+  void *base;
+  size_t len;
+  gboolean restored;
+  char *key;
+};
+
+/*
+ * history_map_ring_len -- bytes taken by one ring: the times, then
+ * values, mins and maxs, rounded up to keep the next ring's times
+ * aligned.
+ */
+static size_t
+history_map_ring_len(gint size)
+{
+  size_t len = size * (sizeof(gdouble) + 3 * sizeof(gfloat));
+  return (len + sizeof(gdouble) - 1) & ~(sizeof(gdouble) - 1);
+}
+
+static gboolean
+history_map_valid(const History_map_header *hdr, gint size, const char *key)
+{
+  gint r;
+
+  if (memcmp(hdr->magic, HISTORY_MAP_MAGIC, sizeof(hdr->magic))
+    || hdr->size != (guint32)size || hdr->rings != HISTORY_MAP_RINGS
+    || hdr->keylen != strlen(key) || memcmp(hdr->key, key, hdr->keylen))
+    return FALSE;
+  for (r = 0; r < HISTORY_MAP_RINGS; r++)
+    if (hdr->ring[r].count < 0 || hdr->ring[r].count > size
+      || hdr->ring[r].newest < 0 || hdr->ring[r].newest >= size)
+      return FALSE;
+  return TRUE;
+}
+
+/*
+ * history_map_open -- maps the file for key under dir, creating it if
+ * need be, and points hist and pyr's arrays into it.  Anything already
+ * in them is discarded.  If the file was left by an earlier run with
+ * the same key and size, its history is picked up where it left off.
+ * Returns NULL, with hist and pyr untouched, if the file can't be had;
+ * in particular if another stripchart has it open.
+ */
+History_map *
+history_map_open(const char *dir, const char *key, gint size,
+  History *hist, History_pyramid *pyr)
+{
+  gint r;
+  int fd;
+  char *sum, *name, *fn;
+  struct stat st;
+  History_map *hm;
+  History_map_header *hdr;
+  size_t len = HISTORY_MAP_HEADER + HISTORY_MAP_RINGS * history_map_ring_len(size);
+  guint8 *ring;
+
+  if (size <= 0 || sizeof(*hdr) + strlen(key) > HISTORY_MAP_HEADER)
+    return NULL;
+
+  sum = g_compute_checksum_for_string(G_CHECKSUM_MD5, key, -1);
+  name = g_strconcat(sum, ".hist", NULL);
+  fn = g_build_filename(dir, name, NULL);
+  g_free(sum);
+  g_free(name);
+
+  fd = open(fn, O_RDWR | O_CREAT, 0644);
+  if (fd < 0 || flock(fd, LOCK_EX | LOCK_NB) < 0 || fstat(fd, &st) < 0)
+    goto fail;
+  if ((size_t)st.st_size != len && (ftruncate(fd, 0) < 0 || ftruncate(fd, len) < 0))
+    goto fail;
+
+  hm = g_malloc(sizeof(*hm));
+  hm->fd = fd;
+  hm->len = len;
+  hm->key = g_strdup(key);
+  hm->base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (hm->base == MAP_FAILED)
+    {
+      g_free(hm->key);
+      g_free(hm);
+      goto fail;
+    }
+  g_free(fn);
+
+  hdr = hm->base;
+  hm->restored = history_map_valid(hdr, size, key);
+  if (!hm->restored)
+    {
+      memset(hdr, 0, HISTORY_MAP_HEADER);
+      memcpy(hdr->magic, HISTORY_MAP_MAGIC, sizeof(hdr->magic));
+      hdr->size = size;
+      hdr->rings = HISTORY_MAP_RINGS;
+      hdr->lower = hdr->upper = NAN;
+      hdr->keylen = strlen(key);
+      memcpy(hdr->key, key, hdr->keylen);
+    }
+
+  history_free(hist);
+  history_pyramid_free(pyr);
+  ring = (guint8 *)hm->base + HISTORY_MAP_HEADER;
+  for (r = 0; r < HISTORY_MAP_RINGS; r++, ring += history_map_ring_len(size))
+    {
+      History *h = r ? &pyr->level[r - 1] : hist;
+
+      h->borrowed = TRUE;
+      h->size = size;
+      h->count = hdr->ring[r].count;
+      h->newest = hdr->ring[r].newest;
+      h->pushed = hdr->ring[r].pushed;
+      h->times = (gdouble *)ring;
+      h->values = (gfloat *)(h->times + size);
+      h->mins = h->values + size;
+      h->maxs = h->mins + size;
+    }
+  memcpy(pyr->part, hdr->part, sizeof(pyr->part));
+  hm->restored = hm->restored && hist->count > 0;
+  return hm;
+
+ fail:
+  fprintf(stderr, "%s: can't keep history in \"%s\": %s\n",
+    prog_name, fn, strerror(errno));
+  if (fd >= 0)
+    close(fd);
+  g_free(fn);
+  return NULL;
+}
+
+/*
+ * history_map_restored -- whether the map held history from an earlier
+ * run, and if so the scale it was last drawn to, NAN if unknown.
+ */
+gboolean
+history_map_restored(const History_map *hm, gdouble *lower, gdouble *upper)
+{
+  const History_map_header *hdr = hm->base;
+
+  *lower = hdr->lower;
+  *upper = hdr->upper;
+  return hm->restored;
+}
+
+/*
+ * history_map_sync -- checkpoints the ring positions and scale into
+ * the header.  The arrays themselves need no syncing.
+ */
+void
+history_map_sync(History_map *hm, const History *hist,
+  const History_pyramid *pyr, gdouble lower, gdouble upper)
+{
+  gint r;
+  History_map_header *hdr = hm->base;
+
+  for (r = 0; r < HISTORY_MAP_RINGS; r++)
+    {
+      const History *h = r ? &pyr->level[r - 1] : hist;
+
+      hdr->ring[r].count = h->count;
+      hdr->ring[r].newest = h->newest;
+      hdr->ring[r].pushed = h->pushed;
+    }
+  memcpy(hdr->part, pyr->part, sizeof(hdr->part));
+  hdr->lower = lower;
+  hdr->upper = upper;
+}
+
+const char *
+history_map_key(const History_map *hm)
+{
+  return hm->key;
+}
+
+/*
+ * history_map_close -- unmaps the file, leaving it for the next run.
+ * Histories pointing into it must be freed first.
+ */
+void
+history_map_close(History_map *hm)
+{
+  munmap(hm->base, hm->len);
+  close(hm->fd);
+  g_free(hm->key);
+  g_free(hm);
+}
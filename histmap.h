@@ -0,0 +1,43 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef HISTMAP_H
+#define HISTMAP_H
+
+#include "history.h"
+
+/*
+ * History_map -- a History and its pyramid kept in a memory-mapped
+ * file, so that they outlive the process.  The file is named for a
+ * checksum of the parameter's key (its name and equation) and holds a
+ * header followed by each ring's arrays.  The arrays are written in
+ * place as samples are pushed; the header's ring positions and scale
+ * are only as current as the last history_map_sync.  Reopening maps
+ * the file back in: nothing is read or copied.
+ */
+typedef struct _History_map History_map;
+
+History_map *history_map_open(const char *dir, const char *key, gint size,
+  History *hist, History_pyramid *pyr);
+gboolean history_map_restored(const History_map *hm,
+  gdouble *lower, gdouble *upper);
+void history_map_sync(History_map *hm, const History *hist,
+  const History_pyramid *pyr, gdouble lower, gdouble upper);
+const char *history_map_key(const History_map *hm);
+void history_map_close(History_map *hm);
+
+#endif /* HISTMAP_H */
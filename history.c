@@ -0,0 +1,393 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "history.h"
+
+void
+history_init(History *hist, gint size)
+{
+  hist->size = size;
+  hist->count = hist->newest = 0;
+  hist->pushed = 0;
+  hist->borrowed = FALSE;
+  hist->values = g_malloc(size * sizeof(*hist->values));
+  hist->mins = g_malloc(size * sizeof(*hist->mins));
+  hist->maxs = g_malloc(size * sizeof(*hist->maxs));
+  hist->times = g_malloc(size * sizeof(*hist->times));
+}
+
+void
+history_free(History *hist)
+{
+  if (!hist->borrowed)
+    {
+      g_free(hist->values);
+      g_free(hist->mins);
+      g_free(hist->maxs);
+      g_free(hist->times);
+    }
+  hist->borrowed = FALSE;
+  hist->values = hist->mins = hist->maxs = NULL;
+  hist->times = NULL;
+  hist->size = hist->count = hist->newest = 0;
+  hist->pushed = 0;
+}
+
+void
+history_push_range(History *hist, gdouble t, gfloat val, gfloat lo, gfloat hi)
+{
+  if (hist->count < hist->size)
+    hist->count++;
+  if (++hist->newest >= hist->size)
+    hist->newest = 0;
+  hist->pushed++;
+  hist->values[hist->newest] = val;
+  hist->mins[hist->newest] = lo;
+  hist->maxs[hist->newest] = hi;
+  hist->times[hist->newest] = t;
+}
+
+void
+history_push(History *hist, gdouble t, gfloat val)
+{
+  history_push_range(hist, t, val, val, val);
+}
+
+/*
+ * history_get -- returns the sample age steps back from the newest,
+ * or NAN if the history doesn't go back that far.
+ */
+gfloat
+history_get(const History *hist, gint age)
+{
+  gint h;
+
+  if (age < 0 || age >= hist->count)
+    return NAN;
+  if ((h = hist->newest - age) < 0)
+    h += hist->size;
+  return hist->values[h];
+}
+
+gdouble
+history_get_time(const History *hist, gint age)
+{
+  gint h;
+
+  if (age < 0 || age >= hist->count)
+    return NAN;
+  if ((h = hist->newest - age) < 0)
+    h += hist->size;
+  return hist->times[h];
+}
+
+#define HISTORY_ARENA_CHUNK	16	/* histories allocated at a time */
+#define HISTORY_ARENA_ALIGN	64
+
+static gsize
+history_arena_round(gsize len)
+{
+  return (len + HISTORY_ARENA_ALIGN - 1) & ~(gsize)(HISTORY_ARENA_ALIGN - 1);
+}
+
+/*
+ * history_arena_take -- points hist at a free slot of the arena, as
+ * history_init would have at arrays of its own.  The first take sets
+ * the arena's size; a history of another size gets arrays of its own.
+ */
+void
+history_arena_take(History_arena *arena, History *hist, gint size)
+{
+  guint8 *slot;
+
+  if (arena->size == 0)
+    {
+      arena->size = size;
+      arena->slot_len = history_arena_round(size * sizeof(gdouble))
+	+ 3 * history_arena_round(size * sizeof(gfloat));
+    }
+  if (size != arena->size)
+    {
+      history_init(hist, size);
+      return;
+    }
+
+  if (arena->free == NULL)
+    {
+      gint i;
+      guint8 *chunk;
+
+      if (posix_memalign((void **)&chunk, HISTORY_ARENA_ALIGN,
+	  HISTORY_ARENA_CHUNK * arena->slot_len) != 0)
+	g_error("out of memory for histories");
+      arena->chunks = g_slist_prepend(arena->chunks, chunk);
+      for (i = HISTORY_ARENA_CHUNK - 1; i >= 0; i--)
+	{
+	  *(gpointer *)(chunk + i * arena->slot_len) = arena->free;
+	  arena->free = chunk + i * arena->slot_len;
+	}
+    }
+  slot = arena->free;
+  arena->free = *(gpointer *)slot;
+
+  hist->size = size;
+  hist->count = hist->newest = 0;
+  hist->pushed = 0;
+  hist->borrowed = TRUE;
+  hist->times = (gdouble *)slot;
+  slot += history_arena_round(size * sizeof(gdouble));
+  hist->values = (gfloat *)slot;
+  slot += history_arena_round(size * sizeof(gfloat));
+  hist->mins = (gfloat *)slot;
+  slot += history_arena_round(size * sizeof(gfloat));
+  hist->maxs = (gfloat *)slot;
+}
+
+/*
+ * history_arena_give -- hands hist's slot back to the arena it came
+ * from, or frees its arrays if it had its own.
+ */
+void
+history_arena_give(History_arena *arena, History *hist)
+{
+  if (hist->borrowed && hist->times)
+    {
+      *(gpointer *)hist->times = arena->free;
+      arena->free = hist->times;
+    }
+  history_free(hist);
+}
+
+/*
+ * history_resize -- gives hist room for size entries, keeping as many
+ * of its newest as fit.  Arrays from the arena, or from history_init
+ * if arena is NULL, replace the old ones, which go back where they
+ * came from; hist mustn't be a map's.  Entry n still lives at index
+ * n % size.
+ */
+void
+history_resize(History *hist, gint size, History_arena *arena)
+{
+  History old = *hist;
+  gint age, keep = MIN(old.count, size);
+
+  if (size == old.size)
+    return;
+
+  if (arena)
+    history_arena_take(arena, hist, size);
+  else
+    history_init(hist, size);
+
+  for (age = 0; age < keep; age++)
+    {
+      gint from = (old.newest - age + old.size) % old.size;
+      gint to = (old.pushed - age) % size;
+
+      hist->times[to] = old.times[from];
+      hist->values[to] = old.values[from];
+      hist->mins[to] = old.mins[from];
+      hist->maxs[to] = old.maxs[from];
+    }
+  hist->count = keep;
+  hist->pushed = old.pushed;
+  hist->newest = old.pushed % size;
+
+  if (arena)
+    history_arena_give(arena, &old);
+  else
+    history_free(&old);
+}
+
+void
+history_window_init(History_window *win)
+{
+  memset(win, 0, sizeof(*win));
+  win->width = -1;
+}
+
+void
+history_window_free(History_window *win)
+{
+  g_free(win->lo);
+  g_free(win->hi);
+  history_window_init(win);
+}
+
+static void
+history_window_add(History_window *win, const History *hist, guint64 n)
+{
+  gint i = n % hist->size;
+  gfloat lo = hist->mins[i], hi = hist->maxs[i];
+
+  if (isfinite(lo))
+    {
+      while (win->lo_len
+	&& lo <= hist->mins[win->lo[(win->lo_first + win->lo_len - 1) % win->cap] % hist->size])
+	win->lo_len--;
+      win->lo[(win->lo_first + win->lo_len++) % win->cap] = n;
+    }
+  if (isfinite(hi))
+    {
+      while (win->hi_len
+	&& hist->maxs[win->hi[(win->hi_first + win->hi_len - 1) % win->cap] % hist->size] <= hi)
+	win->hi_len--;
+      win->hi[(win->hi_first + win->hi_len++) % win->cap] = n;
+    }
+}
+
+/*
+ * history_window_update -- brings the window up to date with the
+ * newest width entries of hist.
+ */
+void
+history_window_update(History_window *win, const History *hist, gint width)
+{
+  guint64 n, oldest;
+
+  /*
+   * Clamp to the ring rather than to count: count grows with each push
+   * while the history fills, and a width that changed on every tick
+   * would rebuild on every tick.
+   */
+  width = CLAMP(width, 1, MAX(hist->size, 1));
+
+  if (win->cap != hist->size)
+    {
+      g_free(win->lo);
+      g_free(win->hi);
+      win->cap = hist->size;
+      win->lo = g_malloc(win->cap * sizeof(*win->lo));
+      win->hi = g_malloc(win->cap * sizeof(*win->hi));
+      win->width = -1;
+    }
+
+  oldest = hist->pushed - MIN(width, hist->count) + 1;
+
+  if (width != win->width || hist->pushed != win->seen + 1)
+    {
+      win->lo_first = win->lo_len = win->hi_first = win->hi_len = 0;
+      for (n = oldest; n <= hist->pushed; n++)
+	history_window_add(win, hist, n);
+      win->width = width;
+    }
+  else
+    history_window_add(win, hist, hist->pushed);
+  win->seen = hist->pushed;
+
+  while (win->lo_len && win->lo[win->lo_first] < oldest)
+    {
+      win->lo_first = (win->lo_first + 1) % win->cap;
+      win->lo_len--;
+    }
+  while (win->hi_len && win->hi[win->hi_first] < oldest)
+    {
+      win->hi_first = (win->hi_first + 1) % win->cap;
+      win->hi_len--;
+    }
+}
+
+/*
+ * history_window_range -- the window's extremes; FALSE if it holds no
+ * finite values.
+ */
+gboolean
+history_window_range(const History_window *win, const History *hist,
+  gdouble *lo, gdouble *hi)
+{
+  if (win->lo_len == 0 || win->hi_len == 0)
+    return FALSE;
+  *lo = hist->mins[win->lo[win->lo_first] % hist->size];
+  *hi = hist->maxs[win->hi[win->hi_first] % hist->size];
+  return TRUE;
+}
+
+void
+history_pyramid_init(History_pyramid *pyr, gint size)
+{
+  gint k;
+
+  memset(pyr->part, 0, sizeof(pyr->part));
+  for (k = 0; k < HISTORY_LEVELS; k++)
+    history_init(&pyr->level[k], size);
+}
+
+void
+history_pyramid_free(History_pyramid *pyr)
+{
+  gint k;
+
+  for (k = 0; k < HISTORY_LEVELS; k++)
+    history_free(&pyr->level[k]);
+}
+
+/*
+ * history_pyramid_push -- folds hist's newest entry into the pyramid,
+ * carrying each level's entry up to the next as it fills.  A level's
+ * mean is taken over finite values only, and is NAN if there were none.
+ */
+void
+history_pyramid_push(History_pyramid *pyr, const History *hist)
+{
+  gint k, h = hist->newest;
+  gdouble t = hist->times[h];
+  gfloat val = hist->values[h], lo = hist->mins[h], hi = hist->maxs[h];
+
+  for (k = 0; k < HISTORY_LEVELS; k++)
+    {
+      History_rollup *p = &pyr->part[k];
+
+      if (p->n++ == 0)
+	{
+	  p->finite = 0;
+	  p->sum = 0;
+	  p->lo = lo;
+	  p->hi = hi;
+	}
+      else
+	{
+	  p->lo = fminf(p->lo, lo);
+	  p->hi = fmaxf(p->hi, hi);
+	}
+      if (isfinite(val))
+	{
+	  p->sum += val;
+	  p->finite++;
+	}
+      if (p->n < HISTORY_FANOUT)
+	return;
+
+      val = p->finite ? p->sum / p->finite : NAN;
+      lo = p->lo;
+      hi = p->hi;
+      history_push_range(&pyr->level[k], t, val, lo, hi);
+      p->n = 0;
+    }
+}
+
+void
+history_pyramid_resize(History_pyramid *pyr, gint size, History_arena *arena)
+{
+  gint k;
+
+  for (k = 0; k < HISTORY_LEVELS; k++)
+    history_resize(&pyr->level[k], size, arena);
+}
@@ -0,0 +1,125 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <glib.h>
+
+/*
+ * History -- a ring of the most recent size samples of a parameter.
+ * values[newest] is the latest; older ones run backwards from there,
+ * wrapping at size, for count samples.  times[] holds when each value
+ * was read, in seconds since the epoch.  When several samples are
+ * reduced to one entry, values[] holds their mean and mins[] and
+ * maxs[] their range; otherwise all three are the same.
+ */
+typedef struct _History
+{
+  gint size, count, newest;
+  guint64 pushed;		/* entry n lives at index n % size */
+  gfloat *values, *mins, *maxs;
+  gdouble *times;
+  gboolean borrowed;		/* the arrays belong to a History_arena or map */
+}
+History;
+
+void history_init(History *hist, gint size);
+void history_free(History *hist);
+void history_push(History *hist, gdouble t, gfloat val);
+void history_push_range(History *hist,
+  gdouble t, gfloat val, gfloat lo, gfloat hi);
+gfloat history_get(const History *hist, gint age);
+gdouble history_get_time(const History *hist, gint age);
+
+/*
+ * History_arena -- histories of one size, carved out of chunks that
+ * each hold several of them back to back.  Each history's times,
+ * values, mins and maxs start on cache line boundaries, and the
+ * histories of parameters added together lie side by side, rather
+ * than scattered about the heap four mallocs apiece.  Slots given back
+ * are reused first.
+ */
+typedef struct
+{
+  gint size;		/* entries in each history */
+  gsize slot_len;	/* bytes per history */
+  GSList *chunks;
+  gpointer free;	/* slots not in use, each holding the next */
+}
+History_arena;
+
+void history_arena_take(History_arena *arena, History *hist, gint size);
+void history_arena_give(History_arena *arena, History *hist);
+void history_resize(History *hist, gint size, History_arena *arena);
+
+/*
+ * History_window -- the smallest min and largest max among a History's
+ * newest width entries.  Each is kept as a monotonic deque of entry
+ * numbers: the front is the current extreme, and an entry is dropped
+ * once a newer one beats it or it falls out of the window.  Keeping up
+ * with each push costs amortized O(1); only a change of width, or
+ * missed pushes, cost a rebuild.
+ */
+typedef struct
+{
+  gint width, cap;
+  guint64 seen;		/* hist->pushed as of the last update */
+  guint64 *lo, *hi;	/* rings of entry numbers */
+  gint lo_first, lo_len, hi_first, hi_len;
+}
+History_window;
+
+void history_window_init(History_window *win);
+void history_window_free(History_window *win);
+void history_window_update(History_window *win, const History *hist, gint width);
+gboolean history_window_range(const History_window *win, const History *hist,
+  gdouble *lo, gdouble *hi);
+
+#define HISTORY_LEVELS	3	/* rollups of 10, 100 and 1000 entries */
+#define HISTORY_FANOUT	10
+
+/*
+ * History_pyramid -- coarser copies of a History.  Each entry of a
+ * level reduces HISTORY_FANOUT entries of the level below to the mean
+ * of their values and the extremes of their ranges; level[0] reduces
+ * the History itself.  Every level is as big as the History, so the
+ * pyramid reaches a thousand times further back in three times the
+ * memory, and a push costs amortized O(1).
+ */
+typedef struct
+{
+  gint n, finite;	/* entries so far, and how many had finite values */
+  gdouble sum;
+  gfloat lo, hi;
+}
+History_rollup;
+
+typedef struct
+{
+  History level[HISTORY_LEVELS];
+  History_rollup part[HISTORY_LEVELS];	/* the entry each level is filling */
+}
+History_pyramid;
+
+void history_pyramid_init(History_pyramid *pyr, gint size);
+void history_pyramid_free(History_pyramid *pyr);
+void history_pyramid_push(History_pyramid *pyr, const History *hist);
+void history_pyramid_resize(History_pyramid *pyr, gint size,
+  History_arena *arena);
+
+#endif /* HISTORY_H */
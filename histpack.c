@@ -0,0 +1,418 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "histpack.h"
+
+/* Worst cases, in bits: the first entry, then each entry after it. */
+#define PACK_FIRST_BITS		(64 + 32)
+#define PACK_ENTRY_BITS		(1 + 4 + 64 + 2 + 5 + 5 + 32)
+#define PACK_OPEN_BYTES \
+  ((PACK_FIRST_BITS + (HISTORY_PACK_BLOCK - 1) * PACK_ENTRY_BITS + 7) / 8)
+
+#define PACK_RUN_BITS		8	/* a run holds up to 256 entries */
+#define PACK_RUN_MIN		4	/* shorter ones are cheaper coded singly */
+
+typedef struct
+{
+  guint64 first;	/* number of the block's first entry */
+  gint n;
+  gsize nbits;
+  guint8 *data;
+}
+Pack_block;
+
+/*
+ * Pack_coder -- what coding each entry depends on: the entry before it,
+ * the interval before that, and the span of meaningful bits in the last
+ * XOR that had to spell its span out.
+ */
+typedef struct
+{
+  gint64 t, delta;	/* milliseconds */
+  guint32 v;
+  gint lead, trail;	/* lead < 0 until there's a span to reuse */
+}
+Pack_coder;
+
+struct _History_pack
+{
+  guint64 retain, pushed;
+  GPtrArray *blocks;	/* sealed, oldest first */
+  Pack_block open;
+  Pack_coder coder;
+  gint run;		/* repeats of the last entry not yet coded */
+};
+
+static void
+pack_put(Pack_block *b, guint64 bits, gint n)
+{
+  while (n > 0)
+    {
+      gint room = 8 - (b->nbits & 7);
+      gint take = MIN(room, n);
+
+      b->data[b->nbits >> 3] |= ((bits >> (n - take)) & ((1u << take) - 1))
+	<< (room - take);
+      b->nbits += take;
+      n -= take;
+    }
+}
+
+static guint64
+pack_get(const Pack_block *b, gsize *pos, gint n)
+{
+  guint64 bits = 0;
+
+  while (n > 0)
+    {
+      gint room = 8 - (*pos & 7);
+      gint take = MIN(room, n);
+
+      bits = (bits << take)
+	| ((b->data[*pos >> 3] >> (room - take)) & ((1u << take) - 1));
+      *pos += take;
+      n -= take;
+    }
+  return bits;
+}
+
+static guint32
+pack_float_bits(gfloat val)
+{
+  guint32 v;
+
+  memcpy(&v, &val, sizeof(v));
+  return v;
+}
+
+static gfloat
+pack_bits_float(guint32 v)
+{
+  gfloat val;
+
+  memcpy(&val, &v, sizeof(val));
+  return val;
+}
+
+static void
+pack_put_entry(Pack_block *b, Pack_coder *c, gint64 t, guint32 v)
+{
+  gint64 delta = t - c->t, dod = delta - c->delta;
+  guint32 x = v ^ c->v;
+
+  pack_put(b, 1, 1);
+  if (dod == 0)
+    pack_put(b, 0, 1);
+  else if (-63 <= dod && dod <= 64)
+    pack_put(b, (0x2 << 7) | (dod + 63), 2 + 7);
+  else if (-255 <= dod && dod <= 256)
+    pack_put(b, (0x6 << 9) | (dod + 255), 3 + 9);
+  else if (-2047 <= dod && dod <= 2048)
+    pack_put(b, (0xe << 12) | (dod + 2047), 4 + 12);
+  else
+    {
+      pack_put(b, 0xf, 4);
+      pack_put(b, dod, 64);
+    }
+
+  if (x == 0)
+    pack_put(b, 0, 1);
+  else
+    {
+      gint lead = __builtin_clz(x), trail = __builtin_ctz(x);
+
+      if (c->lead >= 0 && lead >= c->lead && trail >= c->trail)
+	{
+	  pack_put(b, 0x2, 2);
+	  pack_put(b, x >> c->trail, 32 - c->lead - c->trail);
+	}
+      else
+	{
+	  pack_put(b, 0x3, 2);
+	  pack_put(b, lead, 5);
+	  pack_put(b, 32 - lead - trail - 1, 5);
+	  pack_put(b, x >> trail, 32 - lead - trail);
+	  c->lead = lead;
+	  c->trail = trail;
+	}
+    }
+
+  c->t = t;
+  c->delta = delta;
+  c->v = v;
+}
+
+/*
+ * pack_flush_run -- codes the repeats held back in pack->run, as a
+ * run if there are enough of them to be worth it.
+ */
+static void
+pack_flush_run(History_pack *pack)
+{
+  Pack_coder *c = &pack->coder;
+
+  if (pack->run >= PACK_RUN_MIN)
+    {
+      pack_put(&pack->open, 0, 1);
+      pack_put(&pack->open, pack->run - 1, PACK_RUN_BITS);
+      c->t += c->delta * pack->run;
+    }
+  else
+    while (pack->run-- > 0)
+      pack_put_entry(&pack->open, c, c->t + c->delta, c->v);
+  pack->run = 0;
+}
+
+/*
+ * pack_decode -- decodes all of block b, plus run held-back repeats,
+ * into times and values.  Returns how many entries that was.
+ */
+static gint
+pack_decode(const Pack_block *b, gint run, gdouble *times, gfloat *values)
+{
+  Pack_coder c;
+  gsize pos = 0;
+  gint i = 0;
+
+  if (b->n == 0)
+    return 0;
+
+  c.t = pack_get(b, &pos, 64);
+  c.v = pack_get(b, &pos, 32);
+  c.delta = 0;
+  c.lead = -1;
+  c.trail = 0;
+  times[i] = c.t / 1e3;
+  values[i++] = pack_bits_float(c.v);
+
+  while (pos < b->nbits || run > 0)
+    {
+      gint repeat = 0;
+
+      if (pos >= b->nbits)
+	{
+	  repeat = run;
+	  run = 0;
+	}
+      else if (pack_get(b, &pos, 1) == 0)
+	repeat = pack_get(b, &pos, PACK_RUN_BITS) + 1;
+      else
+	{
+	  gint64 dod;
+
+	  if (pack_get(b, &pos, 1) == 0)
+	    dod = 0;
+	  else if (pack_get(b, &pos, 1) == 0)
+	    dod = (gint64)pack_get(b, &pos, 7) - 63;
+	  else if (pack_get(b, &pos, 1) == 0)
+	    dod = (gint64)pack_get(b, &pos, 9) - 255;
+	  else if (pack_get(b, &pos, 1) == 0)
+	    dod = (gint64)pack_get(b, &pos, 12) - 2047;
+	  else
+	    dod = pack_get(b, &pos, 64);
+
+	  if (pack_get(b, &pos, 1))
+	    {
+	      if (pack_get(b, &pos, 1))
+		{
+		  c.lead = pack_get(b, &pos, 5);
+		  c.trail = 32 - c.lead - (pack_get(b, &pos, 5) + 1);
+		}
+	      c.v ^= pack_get(b, &pos, 32 - c.lead - c.trail) << c.trail;
+	    }
+	  c.delta += dod;
+	  c.t += c.delta;
+	  times[i] = c.t / 1e3;
+	  values[i++] = pack_bits_float(c.v);
+	}
+
+      while (repeat-- > 0)
+	{
+	  c.t += c.delta;
+	  times[i] = c.t / 1e3;
+	  values[i++] = pack_bits_float(c.v);
+	}
+    }
+  return i;
+}
+
+static void
+pack_block_free(Pack_block *b)
+{
+  g_free(b->data);
+  g_free(b);
+}
+
+/*
+ * history_pack_new -- an empty pack that keeps at least retain of the
+ * newest entries, or all of them if retain is zero.
+ */
+History_pack *
+history_pack_new(guint64 retain)
+{
+  History_pack *pack = g_malloc0(sizeof(*pack));
+
+  pack->retain = retain;
+  pack->blocks = g_ptr_array_new();
+  pack->open.data = g_malloc0(PACK_OPEN_BYTES);
+  pack->open.first = 1;
+  return pack;
+}
+
+void
+history_pack_free(History_pack *pack)
+{
+  guint i;
+
+  for (i = 0; i < pack->blocks->len; i++)
+    pack_block_free(g_ptr_array_index(pack->blocks, i));
+  g_ptr_array_free(pack->blocks, TRUE);
+  g_free(pack->open.data);
+  g_free(pack);
+}
+
+/*
+ * history_pack_seal -- moves the full open block, trimmed to size, in
+ * with the sealed ones, and drops the oldest as retain allows.
+ */
+static void
+history_pack_seal(History_pack *pack)
+{
+  Pack_block *b = g_malloc(sizeof(*b));
+
+  pack_flush_run(pack);
+  *b = pack->open;
+  b->data = g_memdup(pack->open.data, (b->nbits + 7) / 8);
+  g_ptr_array_add(pack->blocks, b);
+
+  memset(pack->open.data, 0, PACK_OPEN_BYTES);
+  pack->open.first = pack->pushed + 1;
+  pack->open.n = 0;
+  pack->open.nbits = 0;
+
+  while (pack->retain && pack->blocks->len > 1)
+    {
+      Pack_block *oldest = g_ptr_array_index(pack->blocks, 0);
+      if (pack->pushed - (oldest->first + oldest->n) + 1 < pack->retain)
+	break;
+      g_ptr_array_remove_index(pack->blocks, 0);
+      pack_block_free(oldest);
+    }
+}
+
+void
+history_pack_push(History_pack *pack, gdouble t, gfloat val)
+{
+  Pack_coder *c = &pack->coder;
+  gint64 ms = llround(t * 1e3);
+  guint32 v = pack_float_bits(val);
+
+  pack->pushed++;
+  if (pack->open.n++ == 0)
+    {
+      pack_put(&pack->open, ms, 64);
+      pack_put(&pack->open, v, 32);
+      c->t = ms;
+      c->delta = 0;
+      c->v = v;
+      c->lead = -1;
+    }
+  else if (v == c->v && ms - (c->t + c->delta * pack->run) == c->delta
+    && pack->run < (1 << PACK_RUN_BITS))
+    pack->run++;
+  else
+    {
+      pack_flush_run(pack);
+      if (v == c->v && ms - c->t == c->delta)
+	pack->run++;
+      else
+	pack_put_entry(&pack->open, c, ms, v);
+    }
+
+  if (pack->open.n == HISTORY_PACK_BLOCK)
+    history_pack_seal(pack);
+}
+
+guint64
+history_pack_pushed(const History_pack *pack)
+{
+  return pack->pushed;
+}
+
+guint64
+history_pack_oldest(const History_pack *pack)
+{
+  if (pack->blocks->len)
+    return ((Pack_block *)g_ptr_array_index(pack->blocks, 0))->first;
+  return pack->open.first;
+}
+
+/*
+ * history_pack_bytes -- memory taken by the coded entries.
+ */
+gsize
+history_pack_bytes(const History_pack *pack)
+{
+  guint i;
+  gsize bytes = (pack->open.nbits + 7) / 8;
+
+  for (i = 0; i < pack->blocks->len; i++)
+    bytes += (((Pack_block *)g_ptr_array_index(pack->blocks, i))->nbits + 7) / 8;
+  return bytes;
+}
+
+/*
+ * history_pack_read -- fills times[i] and values[i] with entry first+i
+ * for i < n, decoding only the blocks that takes; times may be NULL.
+ * Entries the pack doesn't hold come back NAN.  Returns how many it
+ * did hold.
+ */
+gint
+history_pack_read(const History_pack *pack, guint64 first, gint n,
+  gdouble *times, gfloat *values)
+{
+  gdouble bt[HISTORY_PACK_BLOCK];
+  gfloat bv[HISTORY_PACK_BLOCK];
+  guint64 oldest = history_pack_oldest(pack), e;
+  gint i, got = 0;
+
+  for (i = 0; i < n; i++)
+    {
+      if (times)
+	times[i] = NAN;
+      values[i] = NAN;
+    }
+
+  for (e = MAX(first, oldest); e < first + n && e <= pack->pushed; )
+    {
+      guint64 k = (e - oldest) / HISTORY_PACK_BLOCK;
+      const Pack_block *b = k < pack->blocks->len
+	? g_ptr_array_index(pack->blocks, k) : &pack->open;
+      gint m = pack_decode(b, b == &pack->open ? pack->run : 0, bt, bv);
+
+      for (i = e - b->first; i < m && e < first + n; i++, e++, got++)
+	{
+	  if (times)
+	    times[e - first] = bt[i];
+	  values[e - first] = bv[i];
+	}
+    }
+  return got;
+}
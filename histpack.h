@@ -0,0 +1,50 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef HISTPACK_H
+#define HISTPACK_H
+
+#include <glib.h>
+
+#define HISTORY_PACK_BLOCK	256	/* entries per block */
+
+/*
+ * History_pack -- a long, compressed record of a parameter's entries,
+ * for keeping far more than a History can afford to.  Entries go into
+ * blocks of HISTORY_PACK_BLOCK, each coded on its own: times as
+ * delta-of-deltas of whole milliseconds, values XORed with the one
+ * before and stripped of leading and trailing zero bits, as Facebook's
+ * Gorilla does, and runs of a value repeated at a steady interval, as
+ * step and indicator series are, counted rather than coded one by one.
+ * A regular gauge takes a few bits an entry; a steady one, a fraction
+ * of a bit.  Reading decodes only the blocks a range falls in.
+ *
+ * Entries are numbered from 1, as a History's pushed count is; the
+ * oldest blocks are dropped to hold retain entries.
+ */
+typedef struct _History_pack History_pack;
+
+History_pack *history_pack_new(guint64 retain);
+void history_pack_free(History_pack *pack);
+void history_pack_push(History_pack *pack, gdouble t, gfloat val);
+guint64 history_pack_pushed(const History_pack *pack);
+guint64 history_pack_oldest(const History_pack *pack);
+gsize history_pack_bytes(const History_pack *pack);
+gint history_pack_read(const History_pack *pack, guint64 first, gint n,
+  gdouble *times, gfloat *values);
+
+#endif /* HISTPACK_H */
@@ -0,0 +1,177 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <libxml/parser.h>	/* XML input routines */
+#include <libxml/tree.h>
+
+#include "utils.h"
+#include "expr.h"
+
+/*
+ * config_file_find -- returns the first existing config file: the one
+ * named on the command line, else ~/.stripchart.conf or ./stripchart.conf.
+ */
+const char *
+config_file_find(const char *fn)
+{
+  int p = 0;
+  static char *config_path[3];
+  struct stat stat_buf;
+
+  if (fn != NULL)
+    return stat(fn, &stat_buf) == 0 ? fn : NULL;
+
+  if (config_path[0] == NULL)
+    {
+      config_path[0] = g_strdup_printf("%s/.stripchart.conf", getenv("HOME"));
+      config_path[1] = g_strdup("stripchart.conf");
+    }
+  for (p = 0; config_path[p] != NULL; p++)
+    if (stat(config_path[p], &stat_buf) == 0)
+      return config_path[p];
+  return NULL;
+}
+
+/*
+ * param_opt_ingest -- reads an XML parameter file into a
+ * null-terminated array of Param_desc objects. 
+ */
+Param_desc **
+param_desc_ingest(const char *fn)
+{
+  int item_count = 0;
+  Param_desc **desc_ptr = g_malloc(sizeof(*desc_ptr));
+  xmlDocPtr doc = xmlParseFile(fn);
+  xmlNodePtr list, param, elem;
+
+  if (!doc || doc->type != XML_DOCUMENT_NODE
+  ||  !xmlDocGetRootElement(doc) || xmlDocGetRootElement(doc)->type != XML_ELEMENT_NODE
+  ||  !xmlstreq(xmlDocGetRootElement(doc)->name, "stripchart") )
+    {
+      static int complaints;
+      if (complaints++ == 0)
+	error("Can't parse parameter file \"%s\".\n", fn);
+      xmlFreeDoc(doc);
+      return NULL;
+    }
+
+  for (list = xmlDocGetRootElement(doc)->xmlChildrenNode; list != NULL; list = list->next)
+    if (list->type == XML_ELEMENT_NODE && xmlstreq(list->name, "parameter-list"))
+      for (param = list->xmlChildrenNode; param; param = param->next)
+	if (param->type == XML_ELEMENT_NODE && xmlstreq(param->name, "parameter"))
+	  {
+	    Param_desc *desc = g_malloc0(sizeof(*desc));
+	    for (elem = param->xmlChildrenNode; elem; elem = elem->next)
+	      if (elem->type == XML_ELEMENT_NODE && elem->xmlChildrenNode)
+	      {
+		const xmlChar *key = elem->name;
+		char *val = g_strdup((const char *)elem->xmlChildrenNode->content);
+
+		if (xmlstreq(key, "name"))
+		  desc->name = val;
+		else if (xmlstreq(key, "description"))
+		  desc->desc = val;
+		else if (xmlstreq(key, "equation"))
+		  desc->eqn = val;
+		else if (xmlstreq(key, "filename"))
+		  desc->fn = val;
+		else if (xmlstreq(key, "pattern"))
+		  desc->pattern = val;
+		else if (xmlstreq(key, "interval"))
+		  desc->interval = val;
+		else if (xmlstreq(key, "adaptive"))
+		  desc->adaptive = val;
+		else if (xmlstreq(key, "weight"))
+		  desc->weight = val;
+		else if (xmlstreq(key, "record"))
+		  desc->record = val;
+		else if (xmlstreq(key, "trigger"))
+		  desc->trigger = val;
+		else if (xmlstreq(key, "top-min"))
+		  desc->top_min = val;
+		else if (xmlstreq(key, "top-max"))
+		  desc->top_max = val;
+		else if (xmlstreq(key, "bot-min"))
+		  desc->bot_min = val;
+		else if (xmlstreq(key, "bot-max"))
+		  desc->bot_max = val;
+		else if (xmlstreq(key, "scale"))
+		  desc->scale = val;
+		else if (xmlstreq(key, "plot"))
+		  desc->plot = val;
+		else if (xmlstreq(key, "color"))
+		  desc->color_names = val;
+		else
+		{
+		  fprintf(stderr,
+		    "%s: file %s: unrecognized tag \"%s\" containing \"%s\"\n",
+		    prog_name, fn, key, val);
+		  g_free(val);
+		}
+	      }
+	    desc_ptr = g_realloc(desc_ptr,
+	      (item_count + 2) * sizeof(*desc_ptr));
+	    desc_ptr[item_count++] = desc;
+	  }
+
+  xmlFreeDoc(doc);
+  desc_ptr[item_count] = NULL;
+  return desc_ptr;
+}
+
+/*
+ * param_group_ingest -- picks the sampling interval, alignment and smoothing out
+ * of a config file's preferences, for users without a Strip to
+ * hand to prefs_ingest.
+ */
+int
+param_group_ingest(Param_group *pg, const char *fn)
+{
+  xmlDocPtr doc = xmlParseFile(fn);
+  xmlNodePtr list, node;
+
+  if (!doc || !xmlDocGetRootElement(doc)
+  ||  !xmlstreq(xmlDocGetRootElement(doc)->name, "stripchart") )
+    {
+      xmlFreeDoc(doc);
+      return 1;
+    }
+
+  for (list = xmlDocGetRootElement(doc)->xmlChildrenNode; list != NULL; list = list->next)
+    if (list->type == XML_ELEMENT_NODE && xmlstreq(list->name,"preferences-list"))
+      for (node = list->xmlChildrenNode; node; node = node->next)
+	if (node->type == XML_ELEMENT_NODE && node->xmlChildrenNode)
+	{
+	  const char *val = (const char *)node->xmlChildrenNode->content;
+
+	  if (xmlstreq(node->name, "strip-update"))
+	    pg->interval = atoi(val);
+	  else if (xmlstreq(node->name, "strip-smooth"))
+	    pg->filter = atof(val);
+	  else if (xmlstreq(node->name, "strip-align"))
+	    pg->align = atoi(val);
+	  else if (xmlstreq(node->name, "strip-column"))
+	    pg->column = atoi(val);
+	}
+
+  xmlFreeDoc(doc);
+  return 0;
+}
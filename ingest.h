@@ -0,0 +1,42 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <glib.h>
+
+typedef struct
+{
+  char *name, *desc, *eqn, *fn, *pattern;
+  char *interval;		/* in ticks of strip-update; 1 if unset */
+  char *adaptive;		/* "TOLERANCE [LOW HIGH]"; see Adaptive */
+  char *weight;			/* share of the history budget; 1 if unset */
+  char *record;			/* nonzero to keep in the flight recorder */
+  char *trigger;		/* "> N" or "< N": fires the flight recorder */
+  char *top_min, *top_max, *bot_min, *bot_max;
+  char *scale, *plot, *color_names;
+}
+Param_desc;
+
+struct _Param_group;
+
+const char *config_file_find(const char *fn);
+Param_desc **param_desc_ingest(const char *fn);
+int param_group_ingest(struct _Param_group *pg, const char *fn);
+
+#endif /* INGEST_H */
@@ -36,6 +36,8 @@ set_color(ChartDatum *datum, const GdkColor *color, int cnum)
 {
   Chart *chart = datum->chart;
 
+  gdk_colormap_free_colors(chart->colormap, &datum->gdk_color[cnum], 1);
+  g_object_unref(datum->gdk_gc[cnum]);
   datum->gdk_color[cnum] = *color;
   gdk_colormap_alloc_color(chart->colormap, &datum->gdk_color[cnum], FALSE, TRUE);
   datum->gdk_gc[cnum] = gdk_gc_new(GTK_WIDGET(chart)->window);
@@ -89,6 +91,11 @@ param_page_set_from_desc(Param_page *page, const Param_desc *desc)
   set_entry(page->eqn, desc? desc->eqn: NULL);
   set_entry(page->fn, desc? desc->fn: NULL);
   set_entry(page->pattern, desc? desc->pattern: NULL);
+  set_entry(page->interval, desc? desc->interval: NULL);
+  set_entry(page->adaptive, desc? desc->adaptive: NULL);
+  set_entry(page->weight, desc? desc->weight: NULL);
+  set_entry(page->record, desc? desc->record: NULL);
+  set_entry(page->trigger, desc? desc->trigger: NULL);
   set_entry(page->top_min, desc? desc->top_min: NULL);
   set_entry(page->top_max, desc? desc->top_max: NULL);
   set_entry(page->bot_min, desc? desc->bot_min: NULL);
@@ -120,6 +127,9 @@ param_page_set_from_desc(Param_page *page, const Param_desc *desc)
     case chart_plot_solid:
       gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(page->solid), TRUE);
       break;
+    case chart_plot_percentile:
+      gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(page->percentile), TRUE);
+      break;
     case chart_plot_indicator:
       gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(page->indicator), TRUE);
       break;
@@ -154,83 +164,6 @@ get_current_page_param(GtkNotebook *notebook)
   return (Param_page *)g_object_get_data(G_OBJECT(page), "page");
 }
 
-/*
- * param_opt_ingest -- reads an XML parameter file into a
- * null-terminated array of Param_desc objects. 
- */
-Param_desc **
-param_desc_ingest(const char *fn)
-{
-  int item_count = 0;
-  Param_desc **desc_ptr = g_malloc(sizeof(*desc_ptr));
-  xmlDocPtr doc = xmlParseFile(fn);
-  xmlNodePtr list, param, elem;
-
-  if (!doc || doc->type != XML_DOCUMENT_NODE
-  ||  !xmlDocGetRootElement(doc) || xmlDocGetRootElement(doc)->type != XML_ELEMENT_NODE
-  ||  !xmlstreq(xmlDocGetRootElement(doc)->name, "stripchart") )
-    {
-      static int complaints;
-      if (complaints++ == 0)
-	error("Can't parse parameter file \"%s\".\n", fn);
-      xmlFreeDoc(doc);
-      return NULL;
-    }
-
-  for (list = xmlDocGetRootElement(doc)->xmlChildrenNode; list != NULL; list = list->next)
-    if (list->type == XML_ELEMENT_NODE && xmlstreq(list->name, "parameter-list"))
-      for (param = list->xmlChildrenNode; param; param = param->next)
-	if (param->type == XML_ELEMENT_NODE && xmlstreq(param->name, "parameter"))
-	  {
-	    Param_desc *desc = g_malloc0(sizeof(*desc));
-	    for (elem = param->xmlChildrenNode; elem; elem = elem->next)
-	      if (elem->type == XML_ELEMENT_NODE && elem->xmlChildrenNode)
-	      {
-		const xmlChar *key = elem->name;
-		char *val = g_strdup((const char *)elem->xmlChildrenNode->content);
-
-		if (xmlstreq(key, "name"))
-		  desc->name = val;
-		else if (xmlstreq(key, "description"))
-		  desc->desc = val;
-		else if (xmlstreq(key, "equation"))
-		  desc->eqn = val;
-		else if (xmlstreq(key, "filename"))
-		  desc->fn = val;
-		else if (xmlstreq(key, "pattern"))
-		  desc->pattern = val;
-		else if (xmlstreq(key, "top-min"))
-		  desc->top_min = val;
-		else if (xmlstreq(key, "top-max"))
-		  desc->top_max = val;
-		else if (xmlstreq(key, "bot-min"))
-		  desc->bot_min = val;
-		else if (xmlstreq(key, "bot-max"))
-		  desc->bot_max = val;
-		else if (xmlstreq(key, "scale"))
-		  desc->scale = val;
-		else if (xmlstreq(key, "plot"))
-		  desc->plot = val;
-		else if (xmlstreq(key, "color"))
-		  desc->color_names = val;
-		else
-		{
-		  fprintf(stderr,
-		    "%s: file %s: unrecognized tag \"%s\" containing \"%s\"\n",
-		    prog_name, fn, key, val);
-		  g_free(val);
-		}
-	      }
-	    desc_ptr = g_realloc(desc_ptr,
-	      (item_count + 2) * sizeof(*desc_ptr));
-	    desc_ptr[item_count++] = desc;
-	  }
-
-  xmlFreeDoc(doc);
-  desc_ptr[item_count] = NULL;
-  return desc_ptr;
-}
-
 static char *
 edit_str(GtkWidget *entry)
 {
@@ -250,6 +183,11 @@ page_to_desc(Param_page *page, Param_desc *desc)
   desc->eqn = edit_str(page->eqn);
   desc->fn = edit_str(page->fn);
   desc->pattern = edit_str(page->pattern);
+  desc->interval = edit_str(page->interval);
+  desc->adaptive = edit_str(page->adaptive);
+  desc->weight = edit_str(page->weight);
+  desc->record = edit_str(page->record);
+  desc->trigger = edit_str(page->trigger);
   desc->top_min = edit_str(page->top_min);
   desc->top_max = edit_str(page->top_max);
   desc->bot_min = edit_str(page->bot_min);
@@ -266,6 +204,8 @@ page_to_desc(Param_page *page, Param_desc *desc)
     desc->plot = strdup("point");
   else if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(page->solid)))
     desc->plot = strdup("solid");
+  else if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(page->percentile)))
+    desc->plot = strdup("percentile");
   else
     desc->plot = strdup("line");
 
@@ -289,6 +229,11 @@ clear_desc(Param_desc *desc)
 	g_free(desc->eqn);
 	g_free(desc->fn);
 	g_free(desc->pattern);
+	g_free(desc->interval);
+	g_free(desc->adaptive);
+	g_free(desc->weight);
+	g_free(desc->record);
+	g_free(desc->trigger);
 	g_free(desc->top_min);
 	g_free(desc->top_max);
 	g_free(desc->bot_min);
@@ -323,7 +268,7 @@ opts_to_file(Chart_app *app, char *fn)
   while ((nb_page = gtk_notebook_get_nth_page(app->notebook, p)) != NULL)
     {
       Param_page *page = g_object_get_data(G_OBJECT(nb_page), "page");
-      if (!page->strip_data || page->strip_data->active)
+      if (!page->strip_data || chart_parameter_active(page->strip_data))
 	{
 	  Param_desc desc;
 	  page_to_desc(page, &desc);
@@ -334,6 +279,11 @@ opts_to_file(Chart_app *app, char *fn)
 	  add_node(node, "equation", desc.eqn);
 	  add_node(node, "filename", desc.fn);
 	  add_node(node, "pattern", desc.pattern);
+	  add_node(node, "interval", desc.interval);
+	  add_node(node, "adaptive", desc.adaptive);
+	  add_node(node, "weight", desc.weight);
+	  add_node(node, "record", desc.record);
+	  add_node(node, "trigger", desc.trigger);
 	  add_node(node, "top-min", desc.top_min);
 	  add_node(node, "top-max", desc.top_max);
 	  add_node(node, "bot-min", desc.bot_min);
@@ -537,7 +487,7 @@ create_param_page(Chart_app *app, Param_page *page, Param_desc *desc)
   GSList *scale_hbox_group = NULL, *type_hbox_group = NULL;
 
   page->notebook = GTK_WIDGET(app->notebook);
-  page->table = gtk_table_new(10, 2, FALSE);
+  page->table = gtk_table_new(15, 2, FALSE);
   gtk_widget_show(page->table);
 
   label = gtk_label_new(("Parameter"));
@@ -719,10 +669,18 @@ create_param_page(Chart_app *app, Param_page *page, Param_desc *desc)
   gtk_widget_show(page->solid);
   gtk_box_pack_start(GTK_BOX(type_hbox), page->solid, FALSE, FALSE, 0);
 
+  page->percentile =
+    gtk_radio_button_new_with_label(type_hbox_group, ("Percentile"));
+  type_hbox_group =
+    gtk_radio_button_get_group(GTK_RADIO_BUTTON(page->percentile));
+  gtk_widget_show(page->percentile);
+  gtk_box_pack_start(GTK_BOX(type_hbox), page->percentile, FALSE, FALSE, 0);
+
   g_signal_connect(G_OBJECT(page->indicator), "toggled", G_CALLBACK(on_type_toggle), page);
   g_signal_connect(G_OBJECT(page->line), "toggled", G_CALLBACK(on_type_toggle), page);
   g_signal_connect(G_OBJECT(page->point), "toggled", G_CALLBACK(on_type_toggle), page);
   g_signal_connect(G_OBJECT(page->solid), "toggled", G_CALLBACK(on_type_toggle), page);
+  g_signal_connect(G_OBJECT(page->percentile), "toggled", G_CALLBACK(on_type_toggle), page);
 
   label = gtk_label_new(("Color"));
   gtk_widget_show(label);
@@ -734,6 +692,62 @@ create_param_page(Chart_app *app, Param_page *page, Param_desc *desc)
   gtk_table_attach(GTK_TABLE(page->table),
     page->color_hbox, 1, 2, 9, 10, GTK_FILL, GTK_FILL, 0, 0);
 
+  label = gtk_label_new(("Interval"));
+  gtk_widget_show(label);
+  gtk_table_attach(GTK_TABLE(page->table),
+    label, 0, 1, 10, 11, 0, 0, 0, 0);
+
+  page->interval = gtk_entry_new();
+  gtk_widget_show(page->interval);
+  g_signal_connect(page->interval, "changed", G_CALLBACK(on_change), page);
+  gtk_table_attach(GTK_TABLE(page->table),
+    page->interval, 1, 2, 10, 11, 0, 0, 0, 0);
+
+  label = gtk_label_new(("Adaptive"));
+  gtk_widget_show(label);
+  gtk_table_attach(GTK_TABLE(page->table),
+    label, 0, 1, 11, 12, 0, 0, 0, 0);
+
+  page->adaptive = gtk_entry_new();
+  gtk_widget_show(page->adaptive);
+  g_signal_connect(page->adaptive, "changed", G_CALLBACK(on_change), page);
+  gtk_table_attach(GTK_TABLE(page->table),
+    page->adaptive, 1, 2, 11, 12, 0, 0, 0, 0);
+
+  label = gtk_label_new(("Weight"));
+  gtk_widget_show(label);
+  gtk_table_attach(GTK_TABLE(page->table),
+    label, 0, 1, 12, 13, 0, 0, 0, 0);
+
+  page->weight = gtk_entry_new();
+  gtk_widget_show(page->weight);
+  g_signal_connect(page->weight, "changed", G_CALLBACK(on_change), page);
+  gtk_table_attach(GTK_TABLE(page->table),
+    page->weight, 1, 2, 12, 13, 0, 0, 0, 0);
+
+  /* The flight recorder picks these up when stripchart starts. */
+  label = gtk_label_new(("Record"));
+  gtk_widget_show(label);
+  gtk_table_attach(GTK_TABLE(page->table),
+    label, 0, 1, 13, 14, 0, 0, 0, 0);
+
+  page->record = gtk_entry_new();
+  gtk_widget_show(page->record);
+  g_signal_connect(page->record, "changed", G_CALLBACK(on_change), page);
+  gtk_table_attach(GTK_TABLE(page->table),
+    page->record, 1, 2, 13, 14, 0, 0, 0, 0);
+
+  label = gtk_label_new(("Trigger"));
+  gtk_widget_show(label);
+  gtk_table_attach(GTK_TABLE(page->table),
+    label, 0, 1, 14, 15, 0, 0, 0, 0);
+
+  page->trigger = gtk_entry_new();
+  gtk_widget_show(page->trigger);
+  g_signal_connect(page->trigger, "changed", G_CALLBACK(on_change), page);
+  gtk_table_attach(GTK_TABLE(page->table),
+    page->trigger, 1, 2, 14, 15, 0, 0, 0, 0);
+
   param_page_set_from_desc(page, desc);
 }
 
@@ -797,8 +811,11 @@ on_apply(GtkAction *act, Chart_app *app)
 
 	  if (strip_datum)
 	    {
-	      if (page->strip_data && page->strip_data->active)
-		chart_parameter_deactivate(CHART(app->strip),page->strip_data);
+	      if (page->strip_data)
+		{
+		  chart_parameter_deactivate(CHART(app->strip), page->strip_data);
+		  chart_parameter_unref(page->strip_data);
+		}
 	      page->strip_data = strip_datum;
 	    }
 
@@ -815,7 +832,12 @@ on_delete_param(GtkAction *act, Chart_app *app)
   GtkWidget *nb_page = gtk_notebook_get_nth_page(app->notebook, n);
   Param_page *page = g_object_get_data(G_OBJECT(nb_page), "page");
 
-  chart_parameter_deactivate(CHART(app->strip), page->strip_data);
+  if (page->strip_data)
+    {
+      chart_parameter_deactivate(CHART(app->strip), page->strip_data);
+      chart_parameter_unref(page->strip_data);
+      page->strip_data = NULL;
+    }
 
   gtk_notebook_remove_page(app->notebook, n);
   if (app->notebook->children == NULL)
@@ -18,52 +18,13 @@
 #ifndef PARAMS_H
 #define PARAMS_H
 
-#ifdef HAVE_LIBGTOP
-#include <glibtop.h>
-#include <glibtop/union.h>
-#endif
-
-#ifdef HAVE_LIBGTOP
-typedef struct
-{
-  glibtop_cpu     cpu;
-  glibtop_mem     mem;
-  glibtop_swap    swap;
-  glibtop_uptime  uptime;
-  glibtop_loadavg loadavg;
-  glibtop_netload netload;
-}
-Gtop;
-#endif /* HAVE_LIBGTOP */
-
-struct _Param_group
-{
-  int interval;
-  int visible;
-  double filter;
-  double t_diff;
-  struct timeval t_last, t_now;
-#ifdef HAVE_LIBGTOP
-  int gtop_cpu, gtop_mem, gtop_swap, gtop_uptime, gtop_load, gtop_net;
-  Gtop gtop_last, gtop_now;
-#endif
-};
-typedef struct _Param_group Param_group;
-
-typedef struct
-{
-  char *name, *desc, *eqn, *fn, *pattern;
-  char *top_min, *top_max, *bot_min, *bot_max;
-  char *scale, *plot, *color_names;
-}
-Param_desc;
-
 typedef struct
 {
-  GtkWidget *table, *name, *desc, *eqn, *fn, *pattern;
+  GtkWidget *table, *name, *desc, *eqn, *fn, *pattern, *interval, *adaptive;
+  GtkWidget *weight, *record, *trigger;
   GtkWidget *top_min, *top_max, *bot_min, *bot_max;
   GtkWidget *log, *linear, *color_hbox, *notebook;
-  GtkWidget *indicator, *line, *point, *solid;
+  GtkWidget *indicator, *line, *point, *solid, *percentile;
 
   int colors, shown, changed;
   GtkWidget **color;
@@ -72,7 +33,6 @@ typedef struct
 }
 Param_page;
 
-Param_desc **param_desc_ingest(const char *fn);
 Param_page *add_page_before(Chart_app *app, int n, Param_desc *desc);
 void on_param_edit(GtkWidget *unused, GtkWidget *editor);
 void create_editor(Chart_app *app);
@@ -33,14 +33,21 @@ prefs_to_doc(Chart_app *app, xmlDocPtr doc)
 
   fmt_node(node, "strip-update", "%.0f", app->strip_param_group->interval);
   fmt_node(node, "strip-smooth", "%.4f", app->strip_param_group->filter);
+  fmt_node(node, "strip-align", "%.0f", app->strip_param_group->align);
+  fmt_node(node, "strip-column", "%.0f", app->strip_param_group->column);
 
   fmt_node(node, "ticks-enable", "%.0f", STRIP(app->strip)->show_ticks);
   fmt_node(node, "ticks-minor", "%.0f", STRIP(app->strip)->minor_ticks);
   fmt_node(node, "ticks-major", "%.0f", STRIP(app->strip)->major_ticks);
+  fmt_node(node, "strip-budget", "%.0f", STRIP(app->strip)->budget);
+  fmt_node(node, "rescale-hysteresis", "%.2f", CHART(app->strip)->hysteresis);
+  fmt_node(node, "rescale-hold", "%.0f", CHART(app->strip)->hold);
+  fmt_node(node, "history-memory", "%.1f",
+    CHART(app->strip)->history_budget / 1048576.0);
 }
 
 int
-prefs_ingest(Chart_app *app, char *fn)
+prefs_ingest(Chart_app *app, const char *fn)
 {
   xmlDocPtr doc = xmlParseFile(fn);
   xmlNodePtr list, node;
@@ -66,12 +73,26 @@ prefs_ingest(Chart_app *app, char *fn)
 	    app->strip_param_group->interval = atoi(val);
 	  else if (xmlstreq(key, "strip-smooth"))
 	    app->strip_param_group->filter = atof(val);
+	  else if (xmlstreq(key, "strip-align"))
+	    app->strip_param_group->align = atoi(val);
+	  else if (xmlstreq(key, "strip-column"))
+	    app->strip_param_group->column = atoi(val);
 	  else if (xmlstreq(key, "ticks-enable"))
 	    STRIP(app->strip)->show_ticks = atoi(val);
 	  else if (xmlstreq(key, "ticks-minor"))
 	    STRIP(app->strip)->minor_ticks = atoi(val);
 	  else if (xmlstreq(key, "ticks-major"))
 	    STRIP(app->strip)->major_ticks = atoi(val);
+	  else if (xmlstreq(key, "strip-budget"))
+	    strip_set_budget(STRIP(app->strip), atoi(val));
+	  else if (xmlstreq(key, "rescale-hysteresis"))
+	    chart_set_hysteresis(CHART(app->strip),
+	      atof(val), CHART(app->strip)->hold);
+	  else if (xmlstreq(key, "rescale-hold"))
+	    chart_set_hysteresis(CHART(app->strip),
+	      CHART(app->strip)->hysteresis, atoi(val));
+	  else if (xmlstreq(key, "history-memory"))
+	    chart_set_history_budget(CHART(app->strip), atof(val) * 1048576);
 	  else
 	    fprintf(stderr,
 	      "%s: unrecognized parameter element: \"%s\" (%s)\n",
@@ -82,15 +103,33 @@ prefs_ingest(Chart_app *app, char *fn)
   return 0;
 }
 
+/*
+ * prefs_column_ticks -- how many sampling ticks go into each column
+ * of the strip.
+ */
+int
+prefs_column_ticks(const Param_group *pg)
+{
+  if (pg->column <= 0 || pg->interval <= 0)
+    return 1;
+  return MAX(1, (pg->column + pg->interval / 2) / pg->interval);
+}
+
 static void
 prefs_load(Prefs_edit *prefs, Chart_app *app)
 {
   gtk_adjustment_set_value(GTK_ADJUSTMENT(prefs->strip_interval), 
     app->strip_param_group->interval / 1000.0);
 
+  gtk_adjustment_set_value(GTK_ADJUSTMENT(prefs->strip_column),
+    app->strip_param_group->column / 1000.0);
+
   gtk_adjustment_set_value(GTK_ADJUSTMENT(prefs->strip_filter), 
     1 - app->strip_param_group->filter);
 
+  gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(prefs->align_button),
+    app->strip_param_group->align);
+
   gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(prefs->ticks_button),
     STRIP(app->strip)->show_ticks);
 
@@ -98,12 +137,24 @@ prefs_load(Prefs_edit *prefs, Chart_app *app)
     STRIP(app->strip)->minor_ticks);
   gtk_adjustment_set_value(GTK_ADJUSTMENT(prefs->major_ticks),
     STRIP(app->strip)->major_ticks);
+
+  gtk_adjustment_set_value(GTK_ADJUSTMENT(prefs->budget),
+    STRIP(app->strip)->budget);
+
+  gtk_adjustment_set_value(GTK_ADJUSTMENT(prefs->hysteresis),
+    CHART(app->strip)->hysteresis * 100);
+  gtk_adjustment_set_value(GTK_ADJUSTMENT(prefs->hold),
+    CHART(app->strip)->hold / 1000.0);
+
+  gtk_adjustment_set_value(GTK_ADJUSTMENT(prefs->memory),
+    CHART(app->strip)->history_budget / 1048576.0);
 }
 
 static void
 prefs_apply(Prefs_edit *prefs, Chart_app *app)
 {
   double strip_interval = GTK_ADJUSTMENT(prefs->strip_interval)->value;
+  double strip_column = GTK_ADJUSTMENT(prefs->strip_column)->value;
   double strip_filter = GTK_ADJUSTMENT(prefs->strip_filter)->value;
 
   int ticks = gtk_toggle_button_get_active(
@@ -111,13 +162,31 @@ prefs_apply(Prefs_edit *prefs, Chart_app *app)
 
   double minor = GTK_ADJUSTMENT(prefs->minor_ticks)->value;
   double major = GTK_ADJUSTMENT(prefs->major_ticks)->value;
+  double budget = GTK_ADJUSTMENT(prefs->budget)->value;
+  double hysteresis = GTK_ADJUSTMENT(prefs->hysteresis)->value;
+  double hold = GTK_ADJUSTMENT(prefs->hold)->value;
+  double memory = GTK_ADJUSTMENT(prefs->memory)->value;
 
   app->strip_param_group->filter = 1 - strip_filter;
 
   app->strip_param_group->interval = strip_interval * 1000;
-  chart_set_interval(CHART(app->strip), app->strip_param_group->interval);
+  app->strip_param_group->column = strip_column * 1000;
+  chart_set_column_ticks(CHART(app->strip),
+    prefs_column_ticks(app->strip_param_group));
+  app->strip_param_group->align = gtk_toggle_button_get_active(
+    GTK_TOGGLE_BUTTON(prefs->align_button));
+  if (!app->fed)
+    {
+      CHART(app->strip)->align = app->strip_param_group->align;
+      chart_set_interval(CHART(app->strip), app->strip_param_group->interval);
+    }
 
   strip_set_ticks(STRIP(app->strip), ticks, major, minor);
+  if (budget != STRIP(app->strip)->budget)
+    strip_set_budget(STRIP(app->strip), budget);
+  chart_set_hysteresis(CHART(app->strip), hysteresis / 100, hold * 1000);
+  if (memory * 1048576 != CHART(app->strip)->history_budget)
+    chart_set_history_budget(CHART(app->strip), memory * 1048576);
 }
 
 static void
@@ -147,9 +216,9 @@ void
 on_prefs_edit(GtkWidget *w, Chart_app *app)
 {
   Prefs_edit *prefs;
-  GtkWidget *vbox, *tick_box;
+  GtkWidget *vbox, *tick_box, *rescale_box;
   GtkWidget *chart_frame, *chart_table;
-  GtkWidget *major_spin, *minor_spin;
+  GtkWidget *major_spin, *minor_spin, *budget_spin, *scale, *spin;
 
   prefs = g_malloc(sizeof(*prefs));
   prefs->app = app;
@@ -169,7 +238,7 @@ on_prefs_edit(GtkWidget *w, Chart_app *app)
   chart_frame = gtk_frame_new(("Chart"));
   gtk_box_pack_start(GTK_BOX(vbox), chart_frame, TRUE, TRUE, 0);
 
-  chart_table = gtk_table_new(3, 2, FALSE);
+  chart_table = gtk_table_new(8, 2, FALSE);
   gtk_container_add(GTK_CONTAINER(chart_frame), chart_table);
 
   tick_box = gtk_hbox_new(FALSE, 0);
@@ -191,10 +260,63 @@ on_prefs_edit(GtkWidget *w, Chart_app *app)
   gtk_box_pack_start(GTK_BOX(tick_box),
     gtk_label_new(("major")), FALSE, FALSE, 0);
 
-  prefs->strip_interval = gtk_adjustment_new(5, 1, 60, 1, 5, 0);
+  prefs->strip_interval = gtk_adjustment_new(5, 0.05, 60, 0.05, 5, 0);
+  scale = gtk_hscale_new(GTK_ADJUSTMENT(prefs->strip_interval));
+  gtk_scale_set_digits(GTK_SCALE(scale), 2);
   gtk_table_attach(GTK_TABLE(chart_table),
-    gtk_hscale_new(GTK_ADJUSTMENT(prefs->strip_interval)),
-    1, 2, 0, 1, GTK_FILL, GTK_FILL, 0, 0);
+    scale, 1, 2, 0, 1, GTK_FILL, GTK_FILL, 0, 0);
+
+  /* Zero keeps one column per update; anything longer averages
+     the updates in each column and shades their range. */
+  prefs->strip_column = gtk_adjustment_new(0, 0, 60, 0.05, 5, 0);
+  scale = gtk_hscale_new(GTK_ADJUSTMENT(prefs->strip_column));
+  gtk_scale_set_digits(GTK_SCALE(scale), 2);
+  gtk_table_attach(GTK_TABLE(chart_table),
+    scale, 1, 2, 4, 5, GTK_FILL, GTK_FILL, 0, 0);
+
+  gtk_table_attach(GTK_TABLE(chart_table),
+    gtk_label_new(("Column")), 0, 1, 4, 5, 0, 0, 8, 0);
+
+  /* Milliseconds an update may take before drawing is cut back;
+     zero never cuts back. */
+  prefs->budget = gtk_adjustment_new(0, 0, 1000, 5, 50, 0);
+  budget_spin = gtk_spin_button_new(GTK_ADJUSTMENT(prefs->budget), 1, 0);
+  gtk_table_attach(GTK_TABLE(chart_table),
+    budget_spin, 1, 2, 5, 6, GTK_FILL, GTK_FILL, 0, 0);
+
+  gtk_table_attach(GTK_TABLE(chart_table),
+    gtk_label_new(("Budget")), 0, 1, 5, 6, 0, 0, 8, 0);
+
+  /* Autoranged bounds shrink only once the data has pulled this
+     percentage of the range clear of them, for this many seconds. */
+  rescale_box = gtk_hbox_new(FALSE, 0);
+  gtk_table_attach(GTK_TABLE(chart_table),
+    rescale_box, 1, 2, 6, 7, GTK_EXPAND | GTK_FILL, GTK_FILL, 0, 0);
+
+  prefs->hysteresis = gtk_adjustment_new(0, 0, 50, 1, 10, 0);
+  spin = gtk_spin_button_new(GTK_ADJUSTMENT(prefs->hysteresis), 1, 0);
+  gtk_box_pack_start(GTK_BOX(rescale_box), spin, TRUE, TRUE, 0);
+  gtk_box_pack_start(GTK_BOX(rescale_box),
+    gtk_label_new(("%")), FALSE, FALSE, 0);
+
+  prefs->hold = gtk_adjustment_new(0, 0, 600, 1, 10, 0);
+  spin = gtk_spin_button_new(GTK_ADJUSTMENT(prefs->hold), 1, 1);
+  gtk_box_pack_start(GTK_BOX(rescale_box), spin, TRUE, TRUE, 0);
+  gtk_box_pack_start(GTK_BOX(rescale_box),
+    gtk_label_new(("sec")), FALSE, FALSE, 0);
+
+  gtk_table_attach(GTK_TABLE(chart_table),
+    gtk_label_new(("Rescale")), 0, 1, 6, 7, 0, 0, 8, 0);
+
+  /* Megabytes shared out among the parameters' histories by weight;
+     zero gives each a screen's width. */
+  prefs->memory = gtk_adjustment_new(0, 0, 4096, 1, 16, 0);
+  spin = gtk_spin_button_new(GTK_ADJUSTMENT(prefs->memory), 1, 1);
+  gtk_table_attach(GTK_TABLE(chart_table),
+    spin, 1, 2, 7, 8, GTK_FILL, GTK_FILL, 0, 0);
+
+  gtk_table_attach(GTK_TABLE(chart_table),
+    gtk_label_new(("Memory")), 0, 1, 7, 8, 0, 0, 8, 0);
 
   prefs->strip_filter = gtk_adjustment_new(0.5, 0, 1, 0.01, 0.1, 0);
   gtk_table_attach(GTK_TABLE(chart_table),
@@ -210,6 +332,13 @@ on_prefs_edit(GtkWidget *w, Chart_app *app)
   gtk_table_attach(GTK_TABLE(chart_table), 
     gtk_label_new(("Ticks")), 0, 1, 2, 3, 0, 0, 8, 0);
 
+  prefs->align_button = gtk_check_button_new_with_label(("to the clock"));
+  gtk_table_attach(GTK_TABLE(chart_table),
+    prefs->align_button, 1, 2, 3, 4, GTK_FILL, GTK_FILL, 0, 0);
+
+  gtk_table_attach(GTK_TABLE(chart_table),
+    gtk_label_new(("Align")), 0, 1, 3, 4, 0, 0, 8, 0);
+
   gtk_box_pack_start(GTK_BOX(vbox),
     gtk_hseparator_new(), TRUE, TRUE, 12);
 
@@ -26,15 +26,18 @@
 typedef struct _Prefs_edit
 {
   Chart_app *app;
-  GtkWidget *dialog, *ticks_button, *pen_button;
-  GtkObject *strip_interval, *strip_filter;
-  GtkObject *minor_ticks, *major_ticks;
+  GtkWidget *dialog, *ticks_button, *align_button, *pen_button;
+  GtkObject *strip_interval, *strip_column, *strip_filter;
+  GtkObject *minor_ticks, *major_ticks, *budget;
+  GtkObject *hysteresis, *hold;
+  GtkObject *memory;
   GtkObject *pen_interval, *pen_filter;
 }
 Prefs_edit;
 
 void prefs_to_doc(Chart_app *app, xmlDocPtr doc);
-int prefs_ingest(Chart_app *app, char *fn);
+int prefs_ingest(Chart_app *app, const char *fn);
 void on_prefs_edit(GtkWidget *w, Chart_app *app);
+int prefs_column_ticks(const Param_group *pg);
 
 #endif /* PREFS_H */
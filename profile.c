@@ -0,0 +1,253 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include "utils.h"
+#include "expr.h"
+#include "histpack.h"
+#include "profile.h"
+
+/*
+ * Source_cost -- what it took to sample one parameter's source.
+ */
+typedef struct
+{
+  const char *name;
+  int ok;
+  double wall, cpu;
+  guint64 syscalls, bytes;
+  unsigned long forks;
+}
+Source_cost;
+
+typedef struct
+{
+  double wall, cpu;
+  guint64 syscalls, bytes;
+}
+Usage;
+
+/*
+ * usage_now -- snapshots wall and cpu time (ours plus reaped children),
+ * and the read/write syscall and byte counts from /proc/self/io.
+ */
+static void
+usage_now(Usage *u)
+{
+  struct timespec ts;
+  struct rusage self, kids;
+  char line[100];
+  FILE *io;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  u->wall = ts.tv_sec + ts.tv_nsec / 1e9;
+
+  getrusage(RUSAGE_SELF, &self);
+  getrusage(RUSAGE_CHILDREN, &kids);
+  u->cpu = self.ru_utime.tv_sec + self.ru_utime.tv_usec / 1e6
+    + self.ru_stime.tv_sec + self.ru_stime.tv_usec / 1e6
+    + kids.ru_utime.tv_sec + kids.ru_utime.tv_usec / 1e6
+    + kids.ru_stime.tv_sec + kids.ru_stime.tv_usec / 1e6;
+
+  u->syscalls = u->bytes = 0;
+  if ((io = fopen("/proc/self/io", "r")) == NULL)
+    return;
+  while (fgets(line, sizeof(line), io))
+    {
+      unsigned long long n;
+      if (sscanf(line, "syscr: %llu", &n) == 1
+	|| sscanf(line, "syscw: %llu", &n) == 1)
+	u->syscalls += n;
+      else if (sscanf(line, "rchar: %llu", &n) == 1)
+	u->bytes = n;
+    }
+  fclose(io);
+}
+
+static int
+cost_cmp(const void *a, const void *b)
+{
+  const Source_cost *ca = a, *cb = b;
+
+  if (ca->ok != cb->ok)
+    return cb->ok - ca->ok;
+  return (ca->wall < cb->wall) - (ca->wall > cb->wall);
+}
+
+/*
+ * profile_sources -- the --profile-sources dry run.  Loads a config
+ * file, compiles each parameter's equation, samples it repeatedly, and
+ * prints a table of per-sample costs, most expensive first.
+ */
+int
+profile_sources(const char *fn, int samples)
+{
+  int p, n, count;
+  Param_desc **desc;
+  Param_group group;
+  Source_cost *cost;
+  Usage before, after, overhead;
+  unsigned long forks;
+
+  if (fn == NULL)
+    {
+      fprintf(stderr, "%s: no config file found\n", prog_name);
+      return EXIT_FAILURE;
+    }
+  if ((desc = param_desc_ingest(fn)) == NULL)
+    return EXIT_FAILURE;
+
+  memset(&group, 0, sizeof(group));
+  group.filter = 1;
+
+  for (count = 0; desc[count]; count++)
+    ;
+  cost = g_malloc0((count ? count : 1) * sizeof(*cost));
+
+  /* Sampling /proc/self/io itself costs a few syscalls and bytes,
+     so measure that once and take it back out of each result. */
+  usage_now(&before);
+  usage_now(&overhead);
+  overhead.syscalls -= before.syscalls;
+  overhead.bytes -= before.bytes;
+
+  for (p = 0; p < count; p++)
+    {
+      Expr *expr;
+
+      cost[p].name = desc[p]->name ? desc[p]->name : "(unnamed)";
+      if ((expr = expr_compile(&group, desc[p])) == NULL)
+	continue;
+      cost[p].ok = TRUE;
+
+      forks = expr_forks(expr);
+      usage_now(&before);
+      for (n = 0; n < samples; n++)
+	evaluate_equation(expr);
+      usage_now(&after);
+
+      cost[p].wall = (after.wall - before.wall) / samples;
+      cost[p].cpu = (after.cpu - before.cpu) / samples;
+      cost[p].syscalls = after.syscalls - before.syscalls;
+      cost[p].syscalls -= MIN(cost[p].syscalls, overhead.syscalls);
+      cost[p].bytes = after.bytes - before.bytes;
+      cost[p].bytes -= MIN(cost[p].bytes, overhead.bytes);
+      cost[p].forks = expr_forks(expr) - forks;
+      free_expr(expr);
+    }
+
+  qsort(cost, count, sizeof(*cost), cost_cmp);
+
+  printf("%-24s %10s %10s %9s %11s %7s\n",
+    "parameter", "wall ms", "cpu ms", "syscalls", "bytes read", "forks");
+  for (p = 0; p < count; p++)
+    if (!cost[p].ok)
+      printf("%-24.24s %10s\n", cost[p].name, "(error)");
+    else
+      printf("%-24.24s %10.3f %10.3f %9.1f %11.0f %7.2f\n", cost[p].name,
+	cost[p].wall * 1e3, cost[p].cpu * 1e3,
+	(double)cost[p].syscalls / samples, (double)cost[p].bytes / samples,
+	(double)cost[p].forks / samples);
+  printf("(per-sample averages over %d samples of %d parameters from %s)\n",
+    samples, count, fn);
+
+  g_free(cost);
+  return EXIT_SUCCESS;
+}
+
+/*
+ * profile_series -- the next value of a synthetic series of the given
+ * kind, i samples in.
+ */
+static gfloat
+profile_series(int kind, int i, gfloat last)
+{
+  switch (kind)
+    {
+    case 0:	/* a noisy gauge */
+      return 50 + 10.0 * rand() / RAND_MAX;
+    case 1:	/* a load average: a slow walk, to two places */
+      return MAX(0, floor((last + (rand() % 21 - 10) / 100.0) * 100 + 0.5) / 100);
+    case 2:	/* a rate from a counter */
+      return rand() % 1000;
+    case 3:	/* a step: a level held for minutes at a time */
+      return rand() % 300 ? last : rand() % 8;
+    default:	/* an indicator, lit now and then */
+      return (i / 60) % 10 == 0;
+    }
+}
+
+/*
+ * profile_history -- the --profile-history dry run.  Packs samples
+ * one-second samples of a few kinds of series, and reports how many
+ * bytes each sample took and how quickly they decode a screenful at a
+ * time.
+ */
+int
+profile_history(int samples)
+{
+  static const char *kinds[] =
+    { "noisy gauge", "load average", "counter rate", "step", "indicator" };
+  const int window = 1920;
+  int k, i;
+  gfloat *values = g_malloc(window * sizeof(*values));
+
+  printf("%-16s %12s %12s %14s\n",
+    "series", "bytes/sample", "push ns", "decode M/sec");
+  for (k = 0; k < (int)G_N_ELEMENTS(kinds); k++)
+    {
+      History_pack *pack = history_pack_new(0);
+      Usage before, after;
+      gfloat val = 0;
+      guint64 e, decoded = 0;
+      double push, decode;
+
+      srand(k + 1);
+      usage_now(&before);
+      for (i = 0; i < samples; i++)
+	{
+	  val = profile_series(k, i, val);
+	  history_pack_push(pack, 1e9 + i, val);
+	}
+      usage_now(&after);
+      push = after.wall - before.wall;
+
+      usage_now(&before);
+      for (e = 1; e <= history_pack_pushed(pack); e += window)
+	decoded += history_pack_read(pack, e, window, NULL, values);
+      usage_now(&after);
+      decode = after.wall - before.wall;
+
+      printf("%-16s %12.3f %12.1f %14.1f\n", kinds[k],
+	(double)history_pack_bytes(pack) / samples,
+	push * 1e9 / samples, decode > 0 ? decoded / decode / 1e6 : 0.0);
+      history_pack_free(pack);
+    }
+  printf("(%d samples of each, read back %d at a time; "
+    "uncompressed, each takes %d bytes)\n",
+    samples, window, (int)(sizeof(gfloat) + sizeof(gdouble)));
+
+  g_free(values);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,266 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "push.h"
+
+extern char *prog_name;
+
+static GHashTable *push_names;
+static GSList *push_list;
+
+typedef struct
+{
+  void (*poll)(gpointer data);
+  gpointer data;
+}
+Push_poll;
+
+static GSList *push_polls;
+
+/*
+ * push_series_get -- finds the series with the given name, creating
+ * it if need be.  Parameters and producers may show up in either order.
+ */
+Push_series *
+push_series_get(const char *name)
+{
+  Push_series *s;
+
+  if (push_names == NULL)
+    push_names = g_hash_table_new(g_str_hash, g_str_equal);
+  if ((s = g_hash_table_lookup(push_names, name)) != NULL)
+    return s;
+
+  s = g_malloc0(sizeof(*s));
+  s->name = g_strdup(name);
+  s->queued = g_array_new(FALSE, FALSE, sizeof(Push_record));
+  s->records = g_array_new(FALSE, FALSE, sizeof(Push_record));
+  g_hash_table_insert(push_names, s->name, s);
+  push_list = g_slist_prepend(push_list, s);
+  return s;
+}
+
+void
+push_series_set(Push_series *s, double value, double t)
+{
+  Push_record rec;
+
+  rec.t = t;
+  rec.value = value;
+  if (s->queued->len < PUSH_RECORDS)
+    g_array_append_val(s->queued, rec);
+  else
+    g_array_index(s->queued, Push_record, PUSH_RECORDS - 1) = rec;
+  s->pending = value;
+  s->pending_t = t;
+  s->updates++;
+}
+
+/*
+ * push_series_add -- adjusts a gauge relative to its latest value.
+ */
+void
+push_series_add(Push_series *s, double delta, double t)
+{
+  push_series_set(s, (s->updates ? s->pending : s->value) + delta, t);
+}
+
+/*
+ * push_series_count -- bumps a counter, whose per-tick value is the
+ * sum of everything counted during that tick.
+ */
+void
+push_series_count(Push_series *s, double count, double t)
+{
+  s->counter = TRUE;
+  s->pending = (s->updates ? s->pending : 0) + count;
+  s->pending_t = t;
+  s->updates++;
+}
+
+/*
+ * push_add_poll -- registers a source that is drained once per tick,
+ * rather than whenever its descriptor becomes readable.
+ */
+void
+push_add_poll(void (*poll)(gpointer data), gpointer data)
+{
+  Push_poll *pp = g_malloc(sizeof(*pp));
+
+  pp->poll = poll;
+  pp->data = data;
+  push_polls = g_slist_append(push_polls, pp);
+}
+
+/*
+ * push_tick -- publishes whatever arrived since the last tick.  Series
+ * with nothing new hold their previous value, and have no records.
+ */
+void
+push_tick(void)
+{
+  GSList *list;
+
+  for (list = push_polls; list != NULL; list = g_slist_next(list))
+    {
+      Push_poll *pp = list->data;
+      pp->poll(pp->data);
+    }
+
+  for (list = push_list; list != NULL; list = g_slist_next(list))
+    {
+      GArray *swap;
+      Push_series *s = list->data;
+
+      g_array_set_size(s->records, 0);
+      if (s->updates == 0)
+	{
+	  if (s->counter)
+	    s->value = 0;
+	  continue;
+	}
+      s->value = s->pending;
+      s->t = s->pending_t;
+      s->updates = 0;
+
+      if (s->counter)
+	{
+	  Push_record rec;
+	  rec.t = s->t;
+	  rec.value = s->value;
+	  g_array_append_val(s->records, rec);
+	  g_array_set_size(s->queued, 0);
+	}
+      else
+	{
+	  swap = s->records;
+	  s->records = s->queued;
+	  s->queued = swap;
+	}
+    }
+}
+
+/*
+ * Push_stream -- a descriptor of newline-delimited "name value [time]"
+ * records, time in Unix seconds and defaulting to when it's read, along
+ * with any partial line left over from the last read.
+ */
+typedef struct
+{
+  int fd;
+  char buf[4096];
+  size_t len;
+}
+Push_stream;
+
+static void
+push_record(char *line)
+{
+  char *name, *val, *t, *e;
+  double value;
+
+  if ((name = strtok(line, " \t\r")) == NULL || *name == '#')
+    return;
+  if ((val = strtok(NULL, " \t\r")) == NULL)
+    return;
+  value = g_ascii_strtod(val, &e);
+  if (e == val)
+    return;
+  t = strtok(NULL, " \t\r");
+  push_series_set(push_series_get(name), value,
+    t ? g_ascii_strtod(t, NULL) : g_get_real_time() / 1e6);
+}
+
+static gboolean
+push_stream_read(GIOChannel *chan, GIOCondition cond, Push_stream *ps)
+{
+  for (;;)
+    {
+      char *line, *nl;
+      ssize_t n = read(ps->fd, ps->buf + ps->len, sizeof(ps->buf) - ps->len);
+
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n < 0 && errno == EAGAIN)
+	return TRUE;
+      if (n <= 0)
+	{
+	  close(ps->fd);
+	  g_free(ps);
+	  return FALSE;
+	}
+
+      ps->len += n;
+      for (line = ps->buf; (nl = memchr(line, '\n', ps->buf + ps->len - line)); line = nl + 1)
+	{
+	  *nl = '\0';
+	  push_record(line);
+	}
+
+      ps->len -= line - ps->buf;
+      if (ps->len == sizeof(ps->buf))
+	ps->len = 0; /* no newline in a whole buffer: drop it */
+      memmove(ps->buf, line, ps->len);
+    }
+}
+
+/*
+ * push_open_stream -- starts reading records from a file, named pipe,
+ * or "-" for stdin.  A named pipe is opened read-write so that it
+ * stays open while producers come and go.
+ */
+gboolean
+push_open_stream(const char *fn)
+{
+  int fd;
+  struct stat st;
+  GIOChannel *chan;
+  Push_stream *ps;
+
+  if (strcmp(fn, "-") == 0)
+    fd = dup(0);
+  else if (stat(fn, &st) == 0 && S_ISFIFO(st.st_mode))
+    fd = open(fn, O_RDWR);
+  else
+    fd = open(fn, O_RDONLY);
+
+  if (fd < 0)
+    {
+      fprintf(stderr, "%s: can't open input \"%s\": %s\n",
+	prog_name, fn, strerror(errno));
+      return FALSE;
+    }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  ps = g_malloc(sizeof(*ps));
+  ps->fd = fd;
+  ps->len = 0;
+
+  chan = g_io_channel_unix_new(fd);
+  g_io_add_watch(chan, G_IO_IN | G_IO_HUP | G_IO_ERR,
+    (GIOFunc)push_stream_read, ps);
+  g_io_channel_unref(chan);
+  return TRUE;
+}
@@ -0,0 +1,67 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef PUSH_H
+#define PUSH_H
+
+#include <glib.h>
+
+#define PUSH_RECORDS	4096	/* a gauge's records kept per tick */
+#define PUSH_SKEW	60.0	/* seconds a record's time may run ahead */
+
+typedef struct
+{
+  double t, value;
+}
+Push_record;
+
+/*
+ * Push_series -- a named value fed by an external producer rather
+ * than fetched by evaluate_equation.  Records land in the pending
+ * fields as they arrive; push_tick folds them into value once a tick.
+ * A record's time is Unix time, seconds since the epoch, as from
+ * gettimeofday or CLOCK_REALTIME; one on any other clock, or going
+ * backwards, is taken as having arrived when it was read.
+ * A gauge also keeps every record of the tick, oldest first, in
+ * records, so that none is lost to the one that came after it; past
+ * PUSH_RECORDS in a tick, later ones overwrite the newest.  A counter
+ * has one record a tick, its sum.
+ */
+typedef struct _Push_series
+{
+  char *name;
+  gboolean counter;	/* sums per tick rather than holding the last value */
+  double value, t;	/* as of the last tick */
+  double pending, pending_t;
+  guint updates;	/* records since the last tick */
+  GArray *queued;	/* of Push_records since the last tick */
+  GArray *records;	/* and those of the last tick */
+}
+Push_series;
+
+Push_series *push_series_get(const char *name);
+void push_series_set(Push_series *s, double value, double t);
+void push_series_add(Push_series *s, double delta, double t);
+void push_series_count(Push_series *s, double count, double t);
+void push_tick(void);
+void push_add_poll(void (*poll)(gpointer data), gpointer data);
+
+gboolean push_open_stream(const char *fn);
+gboolean push_listen(const char *addr);
+gboolean push_attach_ring(const char *shm_name);
+
+#endif /* PUSH_H */
@@ -0,0 +1,618 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "reclog.h"
+
+extern char *prog_name;
+
+#define RECLOG_BATCH_SECS	10	/* longest a tick waits to be written */
+#define RECLOG_QUEUE		8	/* full batches waiting on the writer */
+
+/* A batch as it's filled, and as it's written: header and ticks together. */
+typedef struct
+{
+  struct reclog_batch hdr;
+  char ticks[];
+}
+Reclog_buf;
+
+struct _Reclog
+{
+  char *fn;
+  int fd;
+  gint params;
+  gsize tick_size;
+
+  Reclog_buf *fill;	/* the main thread's */
+  gint64 fill_since;	/* when it was begun, monotonic */
+  guint flush_timer;
+
+  pthread_mutex_t lock;	/* over the queue, closing and dropped */
+  pthread_cond_t ready;
+  Reclog_buf *queue[RECLOG_QUEUE];
+  guint head, queued;
+  gboolean closing;
+  guint64 dropped;	/* ticks */
+
+  pthread_t writer;	/* which alone touches the rest */
+  guint64 end;		/* where the next batch goes */
+  guint64 ticks;
+  GArray *index;
+  int err;
+};
+
+/*
+ * reclog_crc -- the CRC-32 of ISO 3309 and zlib, continuing from crc.
+ */
+guint32
+reclog_crc(guint32 crc, const void *buf, gsize len)
+{
+  static guint32 table[256];
+  const guchar *p = buf;
+
+  if (table[1] == 0)
+    {
+      guint32 i, j, c;
+      for (i = 0; i < 256; i++)
+	{
+	  for (c = i, j = 0; j < 8; j++)
+	    c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+	  table[i] = c;
+	}
+    }
+
+  crc = ~crc;
+  while (len--)
+    crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+static gboolean
+write_all(int fd, const void *buf, gsize len)
+{
+  const char *p = buf;
+
+  while (len)
+    {
+      ssize_t n = write(fd, p, len);
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n <= 0)
+	return FALSE;
+      p += n;
+      len -= n;
+    }
+  return TRUE;
+}
+
+static gboolean
+reclog_batch_ok(const Reclog_map *m, const struct reclog_batch *b)
+{
+  struct reclog_batch h = *b;
+
+  h.crc = 0;
+  return reclog_crc(reclog_crc(0, &h, sizeof(h)),
+    b + 1, b->ticks * m->tick_size) == b->crc;
+}
+
+/*
+ * reclog_map_footer -- takes the index from the footer, if there is
+ * one and it checks out.
+ */
+static gboolean
+reclog_map_footer(Reclog_map *m)
+{
+  struct reclog_footer foot;
+  guint64 len;
+  guint32 crc;
+
+  if (m->size < m->start + sizeof(foot))
+    return FALSE;
+  memcpy(&foot, m->map + m->size - sizeof(foot), sizeof(foot));
+  len = (guint64)foot.batches * sizeof(*m->index);
+  if (foot.magic != RECLOG_INDEX_MAGIC || foot.index_offset < m->start
+    || foot.index_offset + len + sizeof(foot) != m->size)
+    return FALSE;
+
+  crc = foot.crc;
+  foot.crc = 0;
+  if (reclog_crc(reclog_crc(0, m->map + foot.index_offset, len),
+      &foot, sizeof(foot)) != crc)
+    return FALSE;
+
+  m->index = (const struct reclog_index_entry *)(m->map + foot.index_offset);
+  m->batches = foot.batches;
+  m->ticks = foot.ticks;
+  m->end = foot.index_offset;
+  m->closed = TRUE;
+  return TRUE;
+}
+
+/*
+ * reclog_map_walk -- rebuilds the index of a log that wasn't closed,
+ * stopping at the first batch that isn't there whole.  Only the last
+ * batch can have been torn, since each was synced before the next was
+ * begun, so it alone has its CRC checked.
+ */
+static void
+reclog_map_walk(Reclog_map *m)
+{
+  GArray *index = g_array_new(FALSE, FALSE, sizeof(struct reclog_index_entry));
+  struct reclog_index_entry e;
+  const struct reclog_batch *b;
+  guint64 off;
+
+  for (off = m->start; off + sizeof(*b) <= m->size;
+       off += sizeof(*b) + b->ticks * m->tick_size)
+    {
+      b = (const struct reclog_batch *)(m->map + off);
+      if (b->magic != RECLOG_BATCH_MAGIC || b->params != m->params
+	|| b->ticks == 0 || b->ticks > RECLOG_BATCH_TICKS
+	|| off + sizeof(*b) + b->ticks * m->tick_size > m->size)
+	break;
+      e.offset = off;
+      e.first_t = b->first_t;
+      g_array_append_val(index, e);
+      m->ticks += b->ticks;
+    }
+
+  if (index->len > 0)
+    {
+      e = g_array_index(index, struct reclog_index_entry, index->len - 1);
+      b = (const struct reclog_batch *)(m->map + e.offset);
+      if (!reclog_batch_ok(m, b))
+	{
+	  g_array_set_size(index, index->len - 1);
+	  m->ticks -= b->ticks;
+	  off = e.offset;
+	}
+    }
+
+  m->end = off;
+  m->batches = index->len;
+  m->index = (const struct reclog_index_entry *)g_array_free(index, FALSE);
+}
+
+/*
+ * reclog_map_open -- maps a log for reading.  Returns NULL, having
+ * said why, if it can't be opened or isn't a log.
+ */
+Reclog_map *
+reclog_map_open(const char *fn)
+{
+  int fd;
+  gint p;
+  struct stat st;
+  struct reclog_header hdr;
+  const char *name, *end;
+  Reclog_map *m;
+
+  if ((fd = open(fn, O_RDONLY)) < 0 || fstat(fd, &st) < 0)
+    {
+      fprintf(stderr, "%s: can't open recording \"%s\": %s\n",
+	prog_name, fn, strerror(errno));
+      if (fd >= 0)
+	close(fd);
+      return NULL;
+    }
+
+  m = g_malloc0(sizeof(*m));
+  m->size = st.st_size;
+  m->map = m->size >= sizeof(hdr)
+    ? mmap(NULL, m->size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (m->map == MAP_FAILED)
+    {
+      m->map = NULL;
+      goto bad;
+    }
+
+  memcpy(&hdr, m->map, sizeof(hdr));
+  if (memcmp(hdr.magic, RECLOG_MAGIC, sizeof(hdr.magic)) != 0
+    || hdr.version != RECLOG_VERSION
+    || sizeof(hdr) + (guint64)hdr.names_len > m->size
+    || hdr.names_len % 8)
+    goto bad;
+  m->start = sizeof(hdr) + hdr.names_len;
+  m->params = hdr.params;
+  m->tick_size = RECLOG_TICK_SIZE(m->params);
+  hdr.crc = 0;
+  if (reclog_crc(reclog_crc(0, &hdr, sizeof(hdr)),
+      m->map + sizeof(hdr), hdr.names_len) != ((const struct reclog_header *)m->map)->crc)
+    goto bad;
+
+  m->names = g_new(const char *, m->params ? m->params : 1);
+  name = m->map + sizeof(hdr);
+  end = m->map + m->start;
+  for (p = 0; p < m->params; p++)
+    {
+      const char *nul = memchr(name, '\0', end - name);
+      if (nul == NULL)
+	goto bad;
+      m->names[p] = name;
+      name = nul + 1;
+    }
+
+  if (!reclog_map_footer(m))
+    reclog_map_walk(m);
+  return m;
+
+ bad:
+  fprintf(stderr, "%s: \"%s\" isn't a recording\n", prog_name, fn);
+  reclog_map_close(m);
+  return NULL;
+}
+
+/*
+ * reclog_map_batch -- the b'th batch, its ticks following it, or NULL
+ * if it's damaged.  A footer's CRC vouches only for the index, so
+ * every batch is checked to lie wholly within the batches before it's
+ * trusted; with check, its CRC is checked too.
+ */
+const struct reclog_batch *
+reclog_map_batch(const Reclog_map *m, guint b, gboolean check)
+{
+  guint64 off = m->index[b].offset;
+  const struct reclog_batch *batch;
+
+  if (off < m->start || off % 8 || off + sizeof(*batch) > m->end)
+    return NULL;
+  batch = (const struct reclog_batch *)(m->map + off);
+  if (batch->magic != RECLOG_BATCH_MAGIC || batch->params != m->params
+    || batch->ticks == 0 || batch->ticks > RECLOG_BATCH_TICKS
+    || off + sizeof(*batch) + batch->ticks * m->tick_size > m->end)
+    return NULL;
+  return check && !reclog_batch_ok(m, batch) ? NULL : batch;
+}
+
+/*
+ * reclog_map_seek -- the batch holding time t: the last to begin no
+ * later than t, or the first if they all begin after it.
+ */
+guint
+reclog_map_seek(const Reclog_map *m, gdouble t)
+{
+  guint lo = 0, hi = m->batches;
+
+  while (hi - lo > 1)
+    {
+      guint mid = lo + (hi - lo) / 2;
+      if (m->index[mid].first_t <= t)
+	lo = mid;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+void
+reclog_map_close(Reclog_map *m)
+{
+  if (m->index && !m->closed)
+    g_free((gpointer)m->index);
+  if (m->map)
+    munmap((gpointer)m->map, m->size);
+  g_free(m->names);
+  g_free(m);
+}
+
+/*
+ * reclog_resume -- finds where to carry on appending to an existing
+ * log of the same parameters: after its last whole batch, over any
+ * index and footer.
+ */
+static gboolean
+reclog_resume(Reclog *log, const struct reclog_header *hdr, const char *names)
+{
+  Reclog_map *m = reclog_map_open(log->fn);
+
+  if (m == NULL)
+    return FALSE;
+  if (m->start != sizeof(*hdr) + hdr->names_len
+    || memcmp(m->map, hdr, sizeof(*hdr)) != 0
+    || memcmp(m->map + sizeof(*hdr), names, hdr->names_len) != 0)
+    {
+      fprintf(stderr, "%s: \"%s\" isn't a recording of these parameters\n",
+	prog_name, log->fn);
+      reclog_map_close(m);
+      return FALSE;
+    }
+
+  if (!m->closed && m->end < m->size)
+    fprintf(stderr, "%s: \"%s\": dropping %" G_GUINT64_FORMAT
+      " bytes of unfinished batch\n", prog_name, log->fn, m->size - m->end);
+  g_array_append_vals(log->index, m->index, m->batches);
+  log->end = m->end;
+  log->ticks = m->ticks;
+  reclog_map_close(m);
+  return TRUE;
+}
+
+/*
+ * reclog_write -- the writer thread's part: writes a batch after the
+ * last and syncs it.  If that fails, what was written of it is cut off
+ * again, so the log stays whole, and its ticks are counted as dropped.
+ */
+static void
+reclog_write(Reclog *log, Reclog_buf *buf)
+{
+  struct reclog_index_entry e;
+  gsize len = sizeof(buf->hdr) + buf->hdr.ticks * log->tick_size;
+
+  buf->hdr.crc = 0;
+  buf->hdr.crc = reclog_crc(0, buf, len);
+  if (!write_all(log->fd, buf, len) || fdatasync(log->fd) < 0)
+    {
+      int err = errno;
+
+      if (log->err != err)
+	fprintf(stderr, "%s: can't write \"%s\": %s\n",
+	  prog_name, log->fn, strerror(err));
+      log->err = err;
+      if (ftruncate(log->fd, log->end) == 0)
+	lseek(log->fd, log->end, SEEK_SET);
+      pthread_mutex_lock(&log->lock);
+      log->dropped += buf->hdr.ticks;
+      pthread_mutex_unlock(&log->lock);
+      return;
+    }
+
+  log->err = 0;
+  e.offset = log->end;
+  e.first_t = buf->hdr.first_t;
+  g_array_append_val(log->index, e);
+  log->end += len;
+  log->ticks += buf->hdr.ticks;
+}
+
+static void *
+reclog_writer(void *data)
+{
+  Reclog *log = data;
+  Reclog_buf *buf;
+
+  for (;;)
+    {
+      pthread_mutex_lock(&log->lock);
+      while (log->queued == 0 && !log->closing)
+	pthread_cond_wait(&log->ready, &log->lock);
+      if (log->queued == 0)
+	{
+	  pthread_mutex_unlock(&log->lock);
+	  return NULL;
+	}
+      buf = log->queue[log->head];
+      log->head = (log->head + 1) % RECLOG_QUEUE;
+      log->queued--;
+      pthread_mutex_unlock(&log->lock);
+
+      reclog_write(log, buf);
+      g_free(buf);
+    }
+}
+
+/*
+ * reclog_submit -- queues the batch being filled for the writer, or
+ * drops it if the queue is full: the caller is never kept waiting.
+ */
+static void
+reclog_submit(Reclog *log)
+{
+  Reclog_buf *buf = log->fill;
+
+  log->fill = NULL;
+  pthread_mutex_lock(&log->lock);
+  if (log->queued == RECLOG_QUEUE)
+    log->dropped += buf->hdr.ticks;
+  else
+    {
+      log->queue[(log->head + log->queued++) % RECLOG_QUEUE] = buf;
+      pthread_cond_signal(&log->ready);
+      buf = NULL;
+    }
+  pthread_mutex_unlock(&log->lock);
+  g_free(buf);
+}
+
+/*
+ * reclog_flush -- sends a batch that's been filling for too long to be
+ * written, in case the ticks have stopped coming.
+ */
+static gboolean
+reclog_flush(Reclog *log)
+{
+  if (log->fill
+    && g_get_monotonic_time() - log->fill_since >= RECLOG_BATCH_SECS * G_USEC_PER_SEC)
+    reclog_submit(log);
+  return TRUE;
+}
+
+/*
+ * reclog_open -- starts, or carries on appending to, a log of the named
+ * parameters.  Returns NULL, having said why, if the file can't be
+ * opened or holds a log of some other parameters.
+ */
+Reclog *
+reclog_open(const char *fn, gint params, const char **names)
+{
+  gint p;
+  struct stat st;
+  struct reclog_header hdr;
+  GString *blob = g_string_new(NULL);
+  Reclog *log = g_malloc0(sizeof(*log));
+
+  log->fn = g_strdup(fn);
+  log->params = params;
+  log->tick_size = RECLOG_TICK_SIZE(params);
+  log->index = g_array_new(FALSE, FALSE, sizeof(struct reclog_index_entry));
+
+  /* Names are padded out so that batches stay 8-byte aligned. */
+  for (p = 0; p < params; p++)
+    g_string_append_len(blob, names[p], strlen(names[p]) + 1);
+  while (blob->len % 8)
+    g_string_append_c(blob, '\0');
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, RECLOG_MAGIC, sizeof(hdr.magic));
+  hdr.version = RECLOG_VERSION;
+  hdr.params = params;
+  hdr.names_len = blob->len;
+  hdr.crc = reclog_crc(reclog_crc(0, &hdr, sizeof(hdr)), blob->str, blob->len);
+
+  if ((log->fd = open(fn, O_RDWR | O_CREAT, 0644)) < 0 || fstat(log->fd, &st) < 0)
+    {
+      fprintf(stderr, "%s: can't open recording \"%s\": %s\n",
+	prog_name, fn, strerror(errno));
+      goto fail;
+    }
+
+  if (st.st_size == 0)
+    {
+      if (!write_all(log->fd, &hdr, sizeof(hdr))
+	|| !write_all(log->fd, blob->str, blob->len)
+	|| fdatasync(log->fd) < 0)
+	{
+	  fprintf(stderr, "%s: can't write \"%s\": %s\n",
+	    prog_name, fn, strerror(errno));
+	  goto fail;
+	}
+      log->end = sizeof(hdr) + blob->len;
+    }
+  else if (!reclog_resume(log, &hdr, blob->str))
+    goto fail;
+
+  if (ftruncate(log->fd, log->end) < 0 || lseek(log->fd, log->end, SEEK_SET) < 0)
+    {
+      fprintf(stderr, "%s: can't truncate \"%s\": %s\n",
+	prog_name, fn, strerror(errno));
+      goto fail;
+    }
+
+  pthread_mutex_init(&log->lock, NULL);
+  pthread_cond_init(&log->ready, NULL);
+  if ((errno = pthread_create(&log->writer, NULL, reclog_writer, log)) != 0)
+    {
+      fprintf(stderr, "%s: can't start a writer for \"%s\": %s\n",
+	prog_name, fn, strerror(errno));
+      goto fail;
+    }
+
+  log->flush_timer = g_timeout_add_seconds(1, (GSourceFunc)reclog_flush, log);
+  g_string_free(blob, TRUE);
+  return log;
+
+ fail:
+  if (log->fd >= 0)
+    close(log->fd);
+  g_string_free(blob, TRUE);
+  g_array_free(log->index, TRUE);
+  g_free(log->fn);
+  g_free(log);
+  return NULL;
+}
+
+/*
+ * reclog_tick -- adds a tick's values, one per parameter, to the log.
+ */
+void
+reclog_tick(Reclog *log, gdouble t, const gfloat *values)
+{
+  Reclog_buf *buf = log->fill;
+  char *tick;
+
+  if (buf == NULL)
+    {
+      buf = log->fill = g_malloc(sizeof(*buf)
+	+ RECLOG_BATCH_TICKS * log->tick_size);
+      log->fill_since = g_get_monotonic_time();
+      buf->hdr.magic = RECLOG_BATCH_MAGIC;
+      buf->hdr.ticks = 0;
+      buf->hdr.first_t = t;
+      buf->hdr.params = log->params;
+    }
+
+  tick = buf->ticks + buf->hdr.ticks++ * log->tick_size;
+  memcpy(tick, &t, sizeof(t));
+  memcpy(tick + sizeof(t), values, log->params * sizeof(gfloat));
+  memset(tick + sizeof(t) + log->params * sizeof(gfloat), 0,
+    log->tick_size - sizeof(t) - log->params * sizeof(gfloat));
+  buf->hdr.last_t = t;
+
+  if (buf->hdr.ticks == RECLOG_BATCH_TICKS
+    || t - buf->hdr.first_t >= RECLOG_BATCH_SECS)
+    reclog_submit(log);
+}
+
+guint64
+reclog_dropped(Reclog *log)
+{
+  guint64 dropped;
+
+  pthread_mutex_lock(&log->lock);
+  dropped = log->dropped;
+  pthread_mutex_unlock(&log->lock);
+  return dropped;
+}
+
+/*
+ * reclog_close -- writes out what's left, then the index and footer.
+ */
+void
+reclog_close(Reclog *log)
+{
+  struct reclog_footer foot;
+  gsize index_len;
+
+  g_source_remove(log->flush_timer);
+  if (log->fill)
+    reclog_submit(log);
+  pthread_mutex_lock(&log->lock);
+  log->closing = TRUE;
+  pthread_cond_signal(&log->ready);
+  pthread_mutex_unlock(&log->lock);
+  pthread_join(log->writer, NULL);
+
+  index_len = log->index->len * sizeof(struct reclog_index_entry);
+  memset(&foot, 0, sizeof(foot));
+  foot.magic = RECLOG_INDEX_MAGIC;
+  foot.batches = log->index->len;
+  foot.index_offset = log->end;
+  foot.ticks = log->ticks;
+  foot.crc = reclog_crc(reclog_crc(0, log->index->data, index_len),
+    &foot, sizeof(foot));
+  if (!write_all(log->fd, log->index->data, index_len)
+    || !write_all(log->fd, &foot, sizeof(foot))
+    || fdatasync(log->fd) < 0)
+    fprintf(stderr, "%s: can't write the index of \"%s\": %s\n",
+      prog_name, log->fn, strerror(errno));
+  close(log->fd);
+
+  pthread_mutex_destroy(&log->lock);
+  pthread_cond_destroy(&log->ready);
+  g_array_free(log->index, TRUE);
+  g_free(log->fn);
+  g_free(log);
+}
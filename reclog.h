@@ -0,0 +1,120 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef RECLOG_H
+#define RECLOG_H
+
+#include <glib.h>
+
+/*
+ * A recording log is a header naming its parameters, then batches of
+ * ticks, then, once it's been closed cleanly, an index of the batches.
+ * Each tick is a time and one float per parameter, in the header's
+ * order, NAN where a parameter had no value.  Every part carries a
+ * CRC-32 of itself.  Batches are written whole and synced one at a
+ * time, so a crash can tear only the last one; reopening the log
+ * drops it, and any index, and carries on appending after the rest.
+ */
+#define RECLOG_MAGIC		"SCLOG\r\n\032"
+#define RECLOG_VERSION		1
+#define RECLOG_BATCH_MAGIC	0x54424353	/* "SCBT" */
+#define RECLOG_INDEX_MAGIC	0x58494353	/* "SCIX" */
+#define RECLOG_BATCH_TICKS	256		/* most ticks in a batch */
+
+struct reclog_header
+{
+  char magic[8];
+  guint32 version, params;
+  guint32 names_len;	/* bytes of NUL-terminated names that follow */
+  guint32 crc;		/* of this, with crc 0, and the names */
+};
+
+struct reclog_batch
+{
+  guint32 magic, ticks;
+  gdouble first_t, last_t;
+  guint32 params;	/* per tick, as in the header */
+  guint32 crc;		/* of this, with crc 0, and the ticks */
+};
+
+/* Ticks are RECLOG_TICK_SIZE(params) bytes: a double time and floats. */
+#define RECLOG_TICK_SIZE(params) \
+  ((sizeof(gdouble) + (params) * sizeof(gfloat) + 7) & ~(gsize)7)
+#define RECLOG_TICK(batch, tick_size, i) \
+  ((const char *)((batch) + 1) + (gsize)(i) * (tick_size))
+#define RECLOG_TICK_T(tick)	(*(const gdouble *)(tick))
+#define RECLOG_TICK_VALUES(tick) ((const gfloat *)((tick) + sizeof(gdouble)))
+
+struct reclog_index_entry
+{
+  guint64 offset;	/* of the batch's header */
+  gdouble first_t;
+};
+
+/* The last thing in a cleanly closed log, after its index entries. */
+struct reclog_footer
+{
+  guint32 magic, batches;
+  guint64 index_offset;
+  guint64 ticks;
+  guint32 crc;		/* of the index entries, and this with crc 0 */
+  guint32 pad;
+};
+
+/*
+ * Reclog -- a log being written.  reclog_tick only copies a tick into
+ * the batch being filled; full batches go to a writer thread through a
+ * queue of RECLOG_QUEUE, and are dropped, and counted, should the disk
+ * fall that far behind.  A main-loop timeout sends off a batch that's
+ * been filling too long, even if no more ticks come.
+ */
+typedef struct _Reclog Reclog;
+
+Reclog *reclog_open(const char *fn, gint params, const char **names);
+void reclog_tick(Reclog *log, gdouble t, const gfloat *values);
+guint64 reclog_dropped(Reclog *log);
+void reclog_close(Reclog *log);
+
+/*
+ * Reclog_map -- a log mapped for reading.  Its batches are found by
+ * the index, straight from the footer of a log that was closed, or
+ * rebuilt by walking the batches of one that wasn't.
+ */
+typedef struct
+{
+  const char *map;
+  gsize size;
+  gint params;
+  gsize tick_size;
+  const char **names;	/* pointing into the map */
+  const struct reclog_index_entry *index;
+  guint batches;
+  guint64 ticks;
+  guint64 start, end;	/* of the batches */
+  gboolean closed;	/* the index came from a footer */
+}
+Reclog_map;
+
+Reclog_map *reclog_map_open(const char *fn);
+const struct reclog_batch *reclog_map_batch(const Reclog_map *m, guint b,
+  gboolean check);
+guint reclog_map_seek(const Reclog_map *m, gdouble t);
+void reclog_map_close(Reclog_map *m);
+
+guint32 reclog_crc(guint32 crc, const void *buf, gsize len);
+
+#endif /* RECLOG_H */
@@ -0,0 +1,290 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "history.h"
+#include "tick.h"
+#include "recorder.h"
+
+typedef struct
+{
+  const char *name;
+  Expr *expr;
+  History ring;
+  gint cmp;		/* fires crossing above threshold (+1), below (-1), or never */
+  gdouble threshold;
+  gboolean held;	/* the condition held at the last sample */
+}
+Recorder_param;
+
+struct _Recorder
+{
+  char *dir;
+  guint msec;
+  gint pre, post;	/* samples kept either side of a trigger */
+  Param_group group;	/* unsmoothed, for the recorder's Exprs */
+  GPtrArray *params;
+  guint64 samples;	/* taken so far, numbered from 1 */
+  guint64 fired;	/* the sample a recording is centred on; 0 for none */
+  GString *why;
+  guint saved;
+};
+
+static volatile sig_atomic_t recorder_signalled;
+
+static void
+on_recorder_signal(int sig)
+{
+  recorder_signalled = 1;
+}
+
+/*
+ * recorder_new -- a recorder that samples at hz and saves seconds
+ * either side of a trigger into dir.
+ */
+Recorder *
+recorder_new(const char *dir, gdouble hz, gdouble seconds)
+{
+  Recorder *rec = g_malloc0(sizeof(*rec));
+
+  hz = CLAMP(hz, 0.1, 1000);
+  rec->dir = g_strdup(dir);
+  rec->msec = MAX(1000 / hz, 1);
+  rec->pre = rec->post = MAX(seconds * 1000 / rec->msec, 1);
+  rec->group.filter = 1;
+  rec->params = g_ptr_array_new();
+  rec->why = g_string_new(NULL);
+  return rec;
+}
+
+/*
+ * recorder_add -- takes on desc's parameter if it's marked for
+ * recording or has a trigger.  Returns FALSE if it isn't, or if its
+ * equation or trigger won't parse.
+ */
+gboolean
+recorder_add(Recorder *rec, const Param_desc *desc)
+{
+  Recorder_param *rp;
+  const char *s = desc->trigger;
+  char *e;
+  gint cmp = 0;
+  gdouble threshold = 0;
+
+  if (s)
+    {
+      s += strspn(s, " \t");
+      cmp = *s == '>' ? +1 : *s == '<' ? -1 : 0;
+      threshold = g_ascii_strtod(s + 1, &e);
+      if (cmp == 0 || e == s + 1)
+	{
+	  error("can't make sense of trigger \"%s\"\n", desc->trigger);
+	  return FALSE;
+	}
+    }
+  else if (desc->record == NULL || !str_to_gdouble(desc->record, 0))
+    return FALSE;
+
+  rp = g_malloc0(sizeof(*rp));
+  if ((rp->expr = expr_compile(&rec->group, desc)) == NULL)
+    {
+      g_free(rp);
+      return FALSE;
+    }
+  rp->name = desc->name ? desc->name : "(unnamed)";
+  rp->cmp = cmp;
+  rp->threshold = threshold;
+  history_init(&rp->ring, rec->pre + rec->post + 1);
+  g_ptr_array_add(rec->params, rp);
+  return TRUE;
+}
+
+gint
+recorder_params(const Recorder *rec)
+{
+  return rec->params->len;
+}
+
+/*
+ * recorder_trigger -- centres a recording on the next sample, unless
+ * one is already being finished.
+ */
+void
+recorder_trigger(Recorder *rec, const char *why)
+{
+  if (rec->why->len)
+    g_string_append(rec->why, ", ");
+  g_string_append(rec->why, why);
+  if (rec->fired == 0)
+    rec->fired = rec->samples + 1;
+}
+
+guint
+recorder_saved(const Recorder *rec)
+{
+  return rec->saved;
+}
+
+/*
+ * recorder_publish -- gives a finished recording its name, or failing
+ * that, the name with "-1", "-2" and so on added: nothing already
+ * there is ever replaced.  Returns the name used, or NULL.
+ */
+static char *
+recorder_publish(const char *tmp, const char *base)
+{
+  gint n;
+
+  for (n = 0; n < 1000; n++)
+    {
+      char *fn = n ? g_strdup_printf("%s-%d.csv", base, n)
+	: g_strdup_printf("%s.csv", base);
+
+      if (link(tmp, fn) == 0)
+	{
+	  unlink(tmp);
+	  return fn;
+	}
+      g_free(fn);
+      if (errno != EEXIST)
+	break;
+    }
+  return NULL;
+}
+
+/*
+ * recorder_save -- writes the samples around the trigger, one row per
+ * sample with a column per parameter, to a file named for the time
+ * of the trigger, to the millisecond.  It's written under a temporary
+ * name and linked into place, so that whatever picks recordings up
+ * never sees half of one.
+ */
+static void
+recorder_save(Recorder *rec)
+{
+  guint i;
+  gint age, oldest;
+  FILE *fp;
+  char stamp[32], *base, *fn, *tmp;
+  Recorder_param *first = g_ptr_array_index(rec->params, 0);
+  gdouble when = history_get_time(&first->ring, rec->samples - rec->fired);
+  time_t t = when;
+  struct tm tm;
+
+  strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime_r(&t, &tm));
+  base = g_strdup_printf("%s/flight-%s.%03d", rec->dir, stamp,
+    CLAMP((gint)((when - t) * 1000), 0, 999));
+  tmp = g_strconcat(base, ".csv.part", NULL);
+
+  if ((fp = fopen(tmp, "w")) == NULL)
+    error("can't write flight recording \"%s\": %s\n", tmp, strerror(errno));
+  else
+    {
+      fprintf(fp, "# stripchart flight recording: %s\n", rec->why->str);
+      fprintf(fp, "# every %u ms, %d samples before the trigger and %d after\n",
+	rec->msec, rec->pre, rec->post);
+      fprintf(fp, "time");
+      for (i = 0; i < rec->params->len; i++)
+	fprintf(fp, ",%s", ((Recorder_param *)g_ptr_array_index(rec->params, i))->name);
+      fputc('\n', fp);
+
+      oldest = MIN(first->ring.count, rec->samples - rec->fired + rec->pre + 1);
+      for (age = oldest - 1; age >= 0; age--)
+	{
+	  fprintf(fp, "%.6f", history_get_time(&first->ring, age));
+	  for (i = 0; i < rec->params->len; i++)
+	    fprintf(fp, ",%.9g",
+	      history_get(&((Recorder_param *)g_ptr_array_index(rec->params, i))->ring, age));
+	  fputc('\n', fp);
+	}
+
+      if (fclose(fp) != 0 || (fn = recorder_publish(tmp, base)) == NULL)
+	{
+	  error("can't write flight recording \"%s.csv\": %s\n", base, strerror(errno));
+	  unlink(tmp);
+	}
+      else
+	{
+	  rec->saved++;
+	  g_free(fn);
+	}
+    }
+
+  g_free(base);
+  g_free(tmp);
+  g_string_truncate(rec->why, 0);
+  rec->fired = 0;
+}
+
+static gboolean
+recorder_tick(Recorder *rec)
+{
+  guint i;
+  gdouble now = g_get_real_time() / 1e6;
+
+  if (recorder_signalled)
+    {
+      recorder_signalled = 0;
+      recorder_trigger(rec, "SIGUSR1");
+    }
+
+  for (i = 0; i < rec->params->len; i++)
+    {
+      Recorder_param *rp = g_ptr_array_index(rec->params, i);
+      gdouble val = evaluate_equation(rp->expr);
+      gboolean held;
+
+      history_push(&rp->ring, now, val);
+      if (rp->cmp == 0)
+	continue;
+      held = rp->cmp > 0 ? val > rp->threshold : val < rp->threshold;
+      if (held && !rp->held)
+	{
+	  char *why = g_strdup_printf("%s %s %g",
+	    rp->name, rp->cmp > 0 ? ">" : "<", rp->threshold);
+	  recorder_trigger(rec, why);
+	  g_free(why);
+	}
+      rp->held = held;
+    }
+
+  rec->samples++;
+  if (rec->fired && rec->samples >= rec->fired + rec->post)
+    recorder_save(rec);
+  return TRUE;
+}
+
+/*
+ * recorder_start -- starts sampling, and lets SIGUSR1 pull the
+ * trigger.
+ */
+void
+recorder_start(Recorder *rec)
+{
+  if (rec->params->len == 0)
+    return;
+  signal(SIGUSR1, on_recorder_signal);
+  tick_add(rec->msec, FALSE, (GSourceFunc)recorder_tick, rec);
+}
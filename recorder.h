@@ -0,0 +1,45 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <glib.h>
+
+#include "ingest.h"
+#include "expr.h"
+
+/*
+ * Recorder -- the flight recorder.  Parameters marked with <record>
+ * or <trigger> are sampled far faster than the strip scrolls, each by
+ * an Expr of its own, into rings a few seconds long.  When a trigger
+ * fires, the seconds before it and after are written to a file under
+ * dir, and the rings carry on.  A trigger is a parameter's value
+ * crossing a threshold, "> 90" or "< 0.5", or a SIGUSR1 from outside.
+ * Triggers that fire while a recording is being finished are folded
+ * into it.
+ */
+typedef struct _Recorder Recorder;
+
+Recorder *recorder_new(const char *dir, gdouble hz, gdouble seconds);
+gboolean recorder_add(Recorder *rec, const Param_desc *desc);
+gint recorder_params(const Recorder *rec);
+void recorder_start(Recorder *rec);
+void recorder_trigger(Recorder *rec, const char *why);
+guint recorder_saved(const Recorder *rec);
+
+#endif /* RECORDER_H */
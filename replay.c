@@ -0,0 +1,172 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "chart-app.h"
+
+#define REPLAY_FRAME_MS	20	/* how often paced replay catches up */
+#define REPLAY_GAP	60	/* recorded seconds of nothing to skip over */
+
+/*
+ * Replay -- a recording being played into the chart in place of
+ * sampling.  Its parameters are fed, as attached ones are, from
+ * values[p], which holds each one's latest finite value.  Flat out, a
+ * tick is played each time the main loop is idle; paced, a clock that
+ * runs speed times as fast as the wall's is caught up with every frame.
+ */
+typedef struct _Replay
+{
+  Chart_app *app;
+  Reclog_map *log;
+  gdouble speed;
+  gdouble *values;
+  const struct reclog_batch *batch;
+  guint next_batch, next_tick;
+  gdouble clock;	/* recorded time, when paced */
+  gint64 wall, started;	/* monotonic */
+  guint64 played;
+}
+Replay;
+
+/*
+ * replay_peek -- the next tick to play, or NULL at the end.  A batch
+ * that fails its CRC is passed over.
+ */
+static const char *
+replay_peek(Replay *rp)
+{
+  while (rp->batch == NULL || rp->next_tick == rp->batch->ticks)
+    {
+      if (rp->next_batch == rp->log->batches)
+	return NULL;
+      if ((rp->batch = reclog_map_batch(rp->log, rp->next_batch++, TRUE)) == NULL)
+	fprintf(stderr, "%s: skipping damaged batch %u of the recording\n",
+	  prog_name, rp->next_batch - 1);
+      rp->next_tick = 0;
+    }
+  return RECLOG_TICK(rp->batch, rp->log->tick_size, rp->next_tick);
+}
+
+static void
+replay_play(Replay *rp, const char *tick)
+{
+  gint p;
+  const gfloat *values = RECLOG_TICK_VALUES(tick);
+
+  for (p = 0; p < rp->log->params; p++)
+    if (isfinite(values[p]))
+      rp->values[p] = values[p];
+  rp->next_tick++;
+  rp->played++;
+  chart_tick_at(CHART(rp->app->strip), RECLOG_TICK_T(tick));
+}
+
+/*
+ * replay_done -- reports how long the replay took, which, flat out, is
+ * what it's for: it's the same work every time.
+ */
+static void
+replay_done(Replay *rp)
+{
+  gdouble secs = (g_get_monotonic_time() - rp->started) / 1e6;
+
+  printf("%s: replayed %" G_GUINT64_FORMAT " ticks in %.3f s, "
+    "%.0f ticks/s: %u redraws, %u rescales\n",
+    prog_name, rp->played, secs, secs > 0 ? rp->played / secs : 0,
+    STRIP(rp->app->strip)->redraws, CHART(rp->app->strip)->rescales);
+  fflush(stdout);
+  if (rp->speed <= 0)
+    gtk_main_quit();
+}
+
+static gboolean
+replay_flat_out(Replay *rp)
+{
+  const char *tick = replay_peek(rp);
+
+  if (tick == NULL)
+    {
+      replay_done(rp);
+      return FALSE;
+    }
+  replay_play(rp, tick);
+  return TRUE;
+}
+
+static gboolean
+replay_paced(Replay *rp)
+{
+  const char *tick;
+  gint64 now = g_get_monotonic_time();
+
+  rp->clock += (now - rp->wall) / 1e6 * rp->speed;
+  rp->wall = now;
+
+  /* Sessions appended to the same log leave gaps not worth sitting through. */
+  if ((tick = replay_peek(rp)) != NULL && RECLOG_TICK_T(tick) - rp->clock > REPLAY_GAP)
+    rp->clock = RECLOG_TICK_T(tick);
+
+  for (; tick != NULL && RECLOG_TICK_T(tick) <= rp->clock; tick = replay_peek(rp))
+    replay_play(rp, tick);
+
+  if (tick == NULL)
+    {
+      replay_done(rp);
+      return FALSE;
+    }
+  return TRUE;
+}
+
+/*
+ * chart_app_replay -- plays a --record-log recording into the chart
+ * instead of sampling: flat out, exiting once it's done, or at speed
+ * times the pace it was recorded at.  The chart's own timer is stopped.
+ */
+Replay *
+chart_app_replay(Chart_app *app, const char *fn, Param_desc **desc,
+  gdouble speed)
+{
+  gint p;
+  const char *tick;
+  Replay *rp;
+  Reclog_map *log = reclog_map_open(fn);
+
+  if (log == NULL)
+    return NULL;
+
+  rp = g_malloc0(sizeof(*rp));
+  rp->app = app;
+  rp->log = log;
+  rp->speed = speed;
+  rp->values = g_malloc0((log->params ? log->params : 1) * sizeof(*rp->values));
+  for (p = 0; p < log->params; p++)
+    chart_app_feed(app, desc, log->names[p], &rp->values[p]);
+
+  chart_set_interval(CHART(app->strip), 0);
+  rp->started = rp->wall = g_get_monotonic_time();
+  if (speed <= 0)
+    g_idle_add((GSourceFunc)replay_flat_out, rp);
+  else
+    {
+      if ((tick = replay_peek(rp)) != NULL)
+	rp->clock = RECLOG_TICK_T(tick);
+      g_timeout_add(REPLAY_FRAME_MS, (GSourceFunc)replay_paced, rp);
+    }
+  return rp;
+}
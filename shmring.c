@@ -0,0 +1,186 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include "push.h"
+#include "stripchart-ring.h"
+
+#define RING_CHUNK 1024	/* records copied out before re-checking head */
+
+/*
+ * Ring_reader -- our side of a stripchart-ring.h segment.  The segment
+ * may not exist yet, or may be re-created by a restarted producer, so
+ * it's (re)attached lazily from ring_drain.
+ */
+typedef struct
+{
+  char *shm_name;
+  int fd;
+  struct sc_ring *ring;
+  size_t size;
+  guint32 capacity;	/* as read at attach, not trusted to stay put */
+  guint64 tail, lost;
+  Push_series *series[SC_RING_SERIES];
+  struct sc_ring_record chunk[RING_CHUNK];
+}
+Ring_reader;
+
+static void
+ring_detach(Ring_reader *rr)
+{
+  if (rr->ring)
+    munmap(rr->ring, rr->size);
+  if (rr->fd >= 0)
+    close(rr->fd);
+  rr->ring = NULL;
+  rr->fd = -1;
+  rr->tail = 0;
+  memset(rr->series, 0, sizeof(rr->series));
+}
+
+static gboolean
+ring_attach(Ring_reader *rr)
+{
+  struct stat st;
+  struct sc_ring *ring;
+  guint32 capacity;
+
+  if ((rr->fd = shm_open(rr->shm_name, O_RDONLY, 0)) < 0)
+    return FALSE;
+  if (fstat(rr->fd, &st) < 0 || (size_t)st.st_size < sizeof(struct sc_ring))
+    goto fail;
+
+  ring = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, rr->fd, 0);
+  if (ring == MAP_FAILED)
+    goto fail;
+  if (__atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) != SC_RING_MAGIC
+    || ring->version != SC_RING_VERSION
+    || (capacity = ring->capacity) == 0 || (capacity & (capacity - 1)) != 0
+    || sc_ring_size(capacity) == 0
+    || sc_ring_size(capacity) > (size_t)st.st_size)
+    {
+      munmap(ring, st.st_size);
+      goto fail;
+    }
+
+  rr->ring = ring;
+  rr->size = st.st_size;
+  rr->capacity = capacity;
+  rr->tail = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  return TRUE;
+
+ fail:
+  close(rr->fd);
+  rr->fd = -1;
+  return FALSE;
+}
+
+static Push_series *
+ring_series(Ring_reader *rr, guint32 id)
+{
+  if (id >= SC_RING_SERIES)
+    return NULL;
+  if (rr->series[id] == NULL && rr->ring->names[id][0])
+    {
+      char name[SC_RING_NAMELEN];
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      memcpy(name, rr->ring->names[id], sizeof(name));
+      name[sizeof(name) - 1] = '\0';
+      rr->series[id] = push_series_get(name);
+    }
+  return rr->series[id];
+}
+
+/*
+ * ring_drain -- the push_tick poll hook: copies out everything the
+ * producer wrote since the last tick, a chunk at a time.  After each
+ * copy head is read again, and any record old enough that the producer
+ * could have been rewriting it during the copy is thrown away.
+ */
+static void
+ring_drain(Ring_reader *rr)
+{
+  struct stat st;
+  struct sc_ring *ring;
+  guint64 head, latest;
+
+  if (rr->ring == NULL && !ring_attach(rr))
+    return;
+  ring = rr->ring;
+
+  head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  if (head < rr->tail)
+    rr->tail = 0;
+  if (head == rr->tail)
+    {
+      /* Nothing new: see whether the producer has gone and made a new segment. */
+      if (fstat(rr->fd, &st) == 0 && st.st_nlink == 0)
+	ring_detach(rr);
+      return;
+    }
+
+  while (rr->tail < head)
+    {
+      guint64 i, n, first, oldest;
+
+      if (head - rr->tail > rr->capacity)
+	{
+	  rr->lost += head - rr->capacity - rr->tail;
+	  rr->tail = head - rr->capacity;
+	}
+
+      first = rr->tail;
+      n = MIN(head - first, RING_CHUNK);
+      for (i = 0; i < n; i++)
+	rr->chunk[i] = ring->rec[(first + i) & (rr->capacity - 1)];
+      rr->tail = first + n;
+
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      latest = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+      oldest = latest >= rr->capacity ? latest - rr->capacity + 1 : 0;
+
+      for (i = 0; i < n; i++)
+	{
+	  Push_series *s;
+	  if (first + i < oldest)
+	    {
+	      rr->lost++;
+	      continue;
+	    }
+	  if ((s = ring_series(rr, rr->chunk[i].id)) != NULL)
+	    push_series_set(s, rr->chunk[i].value, rr->chunk[i].t);
+	}
+    }
+}
+
+/*
+ * push_attach_ring -- consumes samples from a stripchart-ring.h
+ * segment on every tick.  The producer needn't be running yet.
+ */
+gboolean
+push_attach_ring(const char *shm_name)
+{
+  Ring_reader *rr = g_malloc0(sizeof(*rr));
+
+  rr->shm_name = g_strdup(shm_name);
+  rr->fd = -1;
+  push_add_poll((void (*)(gpointer))ring_drain, rr);
+  return TRUE;
+}
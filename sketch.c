@@ -0,0 +1,225 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "sketch.h"
+
+#define SKETCH_MIN	1e-12	/* magnitudes below this are counted as zero */
+#define SKETCH_TRIM	1e-6	/* weights decayed below this are dropped */
+
+static gdouble
+sketch_log_gamma(void)
+{
+  static gdouble lg;
+
+  if (lg == 0)
+    lg = log((1 + SKETCH_ALPHA) / (1 - SKETCH_ALPHA));
+  return lg;
+}
+
+static gint
+sketch_key(gdouble mag)
+{
+  return ceil(log(mag) / sketch_log_gamma());
+}
+
+/*
+ * sketch_value -- the magnitude a bin stands for: the one within
+ * SKETCH_ALPHA of everything counted in it.
+ */
+static gdouble
+sketch_value(gint key)
+{
+  return 2 * exp(key * sketch_log_gamma()) / (1 + (1 + SKETCH_ALPHA) / (1 - SKETCH_ALPHA));
+}
+
+static void
+sketch_store_clear(Sketch_store *st)
+{
+  if (st->lo <= st->hi)
+    memset(&st->bin[st->lo - st->offset], 0,
+      (st->hi - st->lo + 1) * sizeof(st->bin[0]));
+  st->offset = 0;
+  st->lo = 1;
+  st->hi = 0;
+}
+
+/*
+ * sketch_store_move -- slides the window to start at offset, folding
+ * any bins that fall below it into the new bottom one.  Nothing may
+ * lie above the new window.
+ */
+static void
+sketch_store_move(Sketch_store *st, gint offset)
+{
+  gint k;
+  gdouble old[SKETCH_BINS];
+
+  memcpy(old, st->bin, sizeof(old));
+  memset(st->bin, 0, sizeof(st->bin));
+  for (k = st->lo; k <= st->hi; k++)
+    st->bin[MAX(k, offset) - offset] += old[k - st->offset];
+  st->offset = offset;
+  st->lo = MAX(st->lo, offset);
+}
+
+static void
+sketch_store_add(Sketch_store *st, gint key, gdouble w)
+{
+  if (st->hi < st->lo)
+    {
+      st->offset = key - SKETCH_BINS / 2;
+      st->lo = st->hi = key;
+    }
+  else if (key < st->offset)
+    {
+      gint offset = MAX(st->hi - SKETCH_BINS + 1, key - SKETCH_BINS / 4);
+
+      if (offset < st->offset)
+	sketch_store_move(st, offset);
+      key = MAX(key, st->offset);
+    }
+  else if (key >= st->offset + SKETCH_BINS)
+    sketch_store_move(st, MAX(key - SKETCH_BINS + 1,
+	MIN(st->lo, key - SKETCH_BINS * 3 / 4)));
+
+  st->bin[key - st->offset] += w;
+  st->lo = MIN(st->lo, key);
+  st->hi = MAX(st->hi, key);
+}
+
+void
+sketch_clear(Sketch *sk)
+{
+  sk->count = sk->zero = 0;
+  sketch_store_clear(&sk->pos);
+  sketch_store_clear(&sk->neg);
+}
+
+void
+sketch_add(Sketch *sk, gdouble val)
+{
+  sketch_add_n(sk, val, 1);
+}
+
+/*
+ * sketch_add_n -- counts val n times over, as cheaply as once.
+ */
+void
+sketch_add_n(Sketch *sk, gdouble val, gdouble n)
+{
+  if (!isfinite(val))
+    return;
+  sk->count += n;
+  if (fabs(val) < SKETCH_MIN)
+    sk->zero += n;
+  else if (val > 0)
+    sketch_store_add(&sk->pos, sketch_key(val), n);
+  else
+    sketch_store_add(&sk->neg, sketch_key(-val), n);
+}
+
+/*
+ * sketch_merge -- adds everything counted in other to sk, as though
+ * the samples had been added one by one.
+ */
+void
+sketch_merge(Sketch *sk, const Sketch *other)
+{
+  gint k;
+
+  sk->count += other->count;
+  sk->zero += other->zero;
+  for (k = other->pos.lo; k <= other->pos.hi; k++)
+    if (other->pos.bin[k - other->pos.offset] > 0)
+      sketch_store_add(&sk->pos, k, other->pos.bin[k - other->pos.offset]);
+  for (k = other->neg.lo; k <= other->neg.hi; k++)
+    if (other->neg.bin[k - other->neg.offset] > 0)
+      sketch_store_add(&sk->neg, k, other->neg.bin[k - other->neg.offset]);
+}
+
+static void
+sketch_store_scale(Sketch_store *st, gdouble factor)
+{
+  gint k;
+
+  for (k = st->lo; k <= st->hi; k++)
+    if ((st->bin[k - st->offset] *= factor) < SKETCH_TRIM)
+      st->bin[k - st->offset] = 0;
+  while (st->lo <= st->hi && st->bin[st->lo - st->offset] == 0)
+    st->lo++;
+  while (st->lo <= st->hi && st->bin[st->hi - st->offset] == 0)
+    st->hi--;
+}
+
+/*
+ * sketch_scale -- weighs everything counted so far by factor, as a
+ * decaying sketch does each period to favour recent samples.
+ */
+void
+sketch_scale(Sketch *sk, gdouble factor)
+{
+  sk->count *= factor;
+  sk->zero *= factor;
+  sketch_store_scale(&sk->pos, factor);
+  sketch_store_scale(&sk->neg, factor);
+  if (sk->pos.hi < sk->pos.lo && sk->neg.hi < sk->neg.lo
+    && sk->zero < SKETCH_TRIM)
+    sketch_clear(sk);
+}
+
+/*
+ * sketch_quantile -- the value q of the way up the samples, for q
+ * from 0 to 1, or NAN if there are none.
+ */
+gdouble
+sketch_quantile(const Sketch *sk, gdouble q)
+{
+  gint k;
+  gdouble rank, seen = 0, val = NAN;
+
+  if (sk->count <= 0)
+    return NAN;
+  rank = CLAMP(q, 0, 1) * sk->count;
+
+  for (k = sk->neg.hi; k >= sk->neg.lo; k--)
+    if (sk->neg.bin[k - sk->neg.offset] > 0)
+      {
+	seen += sk->neg.bin[k - sk->neg.offset];
+	val = -sketch_value(k);
+	if (seen >= rank)
+	  return val;
+      }
+  if (sk->zero > 0)
+    {
+      seen += sk->zero;
+      val = 0;
+      if (seen >= rank)
+	return val;
+    }
+  for (k = sk->pos.lo; k <= sk->pos.hi; k++)
+    if (sk->pos.bin[k - sk->pos.offset] > 0)
+      {
+	seen += sk->pos.bin[k - sk->pos.offset];
+	val = sketch_value(k);
+	if (seen >= rank)
+	  return val;
+      }
+  return val;
+}
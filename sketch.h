@@ -0,0 +1,61 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include <glib.h>
+
+#define SKETCH_ALPHA	0.01	/* relative error of any quantile */
+#define SKETCH_BINS	512	/* per sign, spanning a factor of 28000 */
+
+/*
+ * Sketch -- a DDSketch: a quantile summary of however many samples
+ * in fixed space.  Each nonzero sample is counted in the bin of its
+ * magnitude on a logarithmic scale whose bins are 2 * SKETCH_ALPHA
+ * wide, so any quantile comes back within SKETCH_ALPHA of the true
+ * one.  Positive and negative samples have a window of SKETCH_BINS
+ * bins each; a sample below its window's bottom is counted in the
+ * bottom bin, and one above slides the window up, folding the bins it
+ * uncovers into the new bottom one.  Only the lowest quantiles, by
+ * magnitude, lose accuracy that way, which suits latencies: the tail
+ * is what matters.  Adding a sample is O(1); a quantile is
+ * O(SKETCH_BINS).  Counts are weights, so a sketch can be decayed.
+ */
+typedef struct
+{
+  gint offset;		/* key of bin[0] */
+  gint lo, hi;		/* keys of the lowest and highest nonempty bins */
+  gdouble bin[SKETCH_BINS];
+}
+Sketch_store;
+
+typedef struct
+{
+  gdouble count, zero;
+  Sketch_store pos, neg;
+}
+Sketch;
+
+void sketch_clear(Sketch *sk);
+void sketch_add(Sketch *sk, gdouble val);
+void sketch_add_n(Sketch *sk, gdouble val, gdouble n);
+void sketch_merge(Sketch *sk, const Sketch *other);
+void sketch_scale(Sketch *sk, gdouble factor);
+gdouble sketch_quantile(const Sketch *sk, gdouble q);
+
+#endif /* SKETCH_H */
@@ -0,0 +1,252 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+
+#include "push.h"
+
+extern char *prog_name;
+
+#define STATSD_BATCH	64	/* datagrams per recvmmsg */
+#define STATSD_BATCHES	16	/* recvmmsg calls per wakeup */
+#define STATSD_MTU	1500
+
+typedef struct
+{
+  int fd;
+  struct mmsghdr msg[STATSD_BATCH];
+  struct iovec iov[STATSD_BATCH];
+  char buf[STATSD_BATCH][STATSD_MTU + 1];
+  guint64 truncated;	/* lines dropped from datagrams over STATSD_MTU */
+}
+Statsd;
+
+/*
+ * statsd_metric -- applies one "name:value|type[|@rate]" line.  Gauges
+ * hold their latest value (or are nudged by a signed value), counters
+ * are summed over the tick, and timers are treated as gauges.
+ */
+static void
+statsd_metric(char *line, double now)
+{
+  char *val, *type, *rate, *e;
+  double value;
+  Push_series *s;
+
+  if ((val = strchr(line, ':')) == NULL || val == line)
+    return;
+  *val++ = '\0';
+  if ((type = strchr(val, '|')) == NULL)
+    return;
+  *type++ = '\0';
+
+  value = g_ascii_strtod(val, &e);
+  if (e == val)
+    return;
+  s = push_series_get(line);
+
+  switch (*type)
+    {
+    case 'c':
+      if ((rate = strstr(type, "|@")) != NULL && g_ascii_strtod(rate + 2, NULL) > 0)
+	value /= g_ascii_strtod(rate + 2, NULL);
+      push_series_count(s, value, now);
+      break;
+    case 'g':
+      if (*val == '+' || *val == '-')
+	push_series_add(s, value, now);
+      else
+	push_series_set(s, value, now);
+      break;
+    case 'm':
+    case 'h':
+      push_series_set(s, value, now);
+      break;
+    }
+}
+
+/*
+ * statsd_read -- drains queued datagrams a batch at a time.  After
+ * STATSD_BATCHES batches it yields to the main loop so that a flood
+ * of packets can't starve redraws; the rest wait in the socket buffer.
+ * A datagram cut short at STATSD_MTU loses its last line, which would
+ * otherwise be read as a metric with a truncated value.
+ */
+static gboolean
+statsd_read(GIOChannel *chan, GIOCondition cond, Statsd *sd)
+{
+  int b, i;
+  double now = g_get_real_time() / 1e6;
+
+  for (b = 0; b < STATSD_BATCHES; b++)
+    {
+      int n = recvmmsg(sd->fd, sd->msg, STATSD_BATCH, MSG_DONTWAIT, NULL);
+
+      if (n < 0)
+	return errno == EAGAIN || errno == EINTR;
+
+      for (i = 0; i < n; i++)
+	{
+	  char *line, *next, *pkt = sd->buf[i];
+	  pkt[sd->msg[i].msg_len] = '\0';
+	  if (sd->msg[i].msg_hdr.msg_flags & MSG_TRUNC)
+	    {
+	      if ((line = strrchr(pkt, '\n')) != NULL)
+		*line = '\0';
+	      else
+		*pkt = '\0';
+	      if (sd->truncated++ == 0)
+		fprintf(stderr, "%s: dropping metrics cut off by datagrams over %d bytes\n",
+		  prog_name, STATSD_MTU);
+	    }
+	  for (line = pkt; line; line = next)
+	    {
+	      if ((next = strchr(line, '\n')) != NULL)
+		*next++ = '\0';
+	      if (*line)
+		statsd_metric(line, now);
+	    }
+	  sd->msg[i].msg_len = 0;
+	}
+      if (n < STATSD_BATCH)
+	break;
+    }
+  return TRUE;
+}
+
+static int
+statsd_socket(const char *addr)
+{
+  int fd, rcvbuf = 4 << 20;
+
+  if (strchr(addr, '/'))
+    {
+      struct sockaddr_un sun;
+
+      memset(&sun, 0, sizeof(sun));
+      sun.sun_family = AF_UNIX;
+      if (strlen(addr) >= sizeof(sun.sun_path))
+	{
+	  errno = ENAMETOOLONG;
+	  return -1;
+	}
+      strcpy(sun.sun_path, addr);
+      unlink(addr);
+      if ((fd = socket(AF_UNIX, SOCK_DGRAM, 0)) < 0)
+	return -1;
+      if (bind(fd, (struct sockaddr *)&sun, sizeof(sun)) < 0)
+	{
+	  close(fd);
+	  return -1;
+	}
+    }
+  else
+    {
+      struct addrinfo hints, *ai;
+      char *copy = g_strdup(addr), *host = copy, *port;
+      int err;
+
+      /* An IPv6 host has colons of its own, so it's written [host]:port. */
+      if (*host == '[')
+	{
+	  if ((port = strchr(++host, ']')) == NULL || port[1] != ':')
+	    {
+	      g_free(copy);
+	      errno = EINVAL;
+	      return -1;
+	    }
+	  *port = '\0';
+	  port += 2;
+	}
+      else if ((port = strrchr(host, ':')) != NULL)
+	*port++ = '\0';
+      else
+	{
+	  port = host;
+	  host = NULL;
+	}
+
+      memset(&hints, 0, sizeof(hints));
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_DGRAM;
+      hints.ai_flags = AI_PASSIVE;
+      err = getaddrinfo(host && *host ? host : NULL, port, &hints, &ai);
+      g_free(copy);
+      if (err != 0)
+	{
+	  errno = EINVAL;
+	  return -1;
+	}
+
+      fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (fd >= 0 && bind(fd, ai->ai_addr, ai->ai_addrlen) < 0)
+	{
+	  close(fd);
+	  fd = -1;
+	}
+      freeaddrinfo(ai);
+      if (fd < 0)
+	return -1;
+    }
+
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  return fd;
+}
+
+/*
+ * push_listen -- accepts statsd-style datagrams on a UDP [host:]port,
+ * with an IPv6 host in brackets as in "[::1]:8125", or on a Unix
+ * datagram socket when addr looks like a path.
+ */
+gboolean
+push_listen(const char *addr)
+{
+  int i;
+  Statsd *sd;
+  GIOChannel *chan;
+  int fd = statsd_socket(addr);
+
+  if (fd < 0)
+    {
+      fprintf(stderr, "%s: can't listen on \"%s\": %s\n",
+	prog_name, addr, strerror(errno));
+      return FALSE;
+    }
+
+  sd = g_malloc0(sizeof(*sd));
+  sd->fd = fd;
+  for (i = 0; i < STATSD_BATCH; i++)
+    {
+      sd->iov[i].iov_base = sd->buf[i];
+      sd->iov[i].iov_len = STATSD_MTU;
+      sd->msg[i].msg_hdr.msg_iov = &sd->iov[i];
+      sd->msg[i].msg_hdr.msg_iovlen = 1;
+    }
+
+  chan = g_io_channel_unix_new(fd);
+  g_io_add_watch(chan, G_IO_IN, (GIOFunc)statsd_read, sd);
+  g_io_channel_unref(chan);
+  return TRUE;
+}
@@ -15,124 +15,317 @@
  * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 
+#include <math.h>
 #include <stdio.h>
 
 #include "strip.h"
 
+/*
+ * strip_history -- the level of datum's history that the strip is
+ * zoomed to: the history itself, or one of its pyramid's rollups.
+ */
+static const History *
+strip_history(Strip *strip, ChartDatum *datum)
+{
+  if (strip->zoom == 0)
+    return &datum->history;
+  return &datum->pyramid.level[strip->zoom - 1];
+}
+
+/*
+ * strip_span -- how many columns of history each column on screen
+ * stands for at the strip's zoom.
+ */
+static gint
+strip_span(Strip *strip)
+{
+  gint k, span = 1;
+
+  for (k = 0; k < strip->zoom; k++)
+    span *= HISTORY_FANOUT;
+  return span;
+}
+
+/*
+ * strip_pan_limit -- how far back the strip can be panned: as far as
+ * the deepest history goes, or at the unzoomed level the archives.
+ */
+static gint
+strip_pan_limit(Strip *strip)
+{
+  Chart *chart = CHART(strip);
+  gint p, depth = chart->default_history_size;
+
+  for (p = 0; p < chart->params; p++)
+    depth = MAX(depth, CHART_PARAM(chart, p)->history.size);
+  if (strip->zoom == 0 && chart->retain)
+    return MAX(depth, MIN(chart->retain, G_MAXINT));
+  return depth;
+}
+
+/*
+ * strip_draw_envelope -- shades the range of the samples that went
+ * into entry h of hist, when there was more than one of them.
+ */
+static void
+strip_draw_envelope(Strip *strip, ChartDatum *datum,
+  const History *hist, gint h, gint x)
+{
+  GtkWidget *widget = GTK_WIDGET(strip);
+  gint height = widget->allocation.height;
+  gfloat lo = hist->mins[h], hi = hist->maxs[h];
+
+  if (lo < hi && datum->envelope_gc)
+    gdk_draw_line(widget->window, datum->envelope_gc,
+      x, val2gdk(lo, datum->adj, height, datum->scale_style),
+      x, val2gdk(hi, datum->adj, height, datum->scale_style));
+}
+
+/*
+ * strip_draw_bands -- shades a percentile plot's column, age columns
+ * back, from its p50 to its p99, and marks its p95 and p99 in the
+ * plot's second and third colors, where it has them.
+ */
+static void
+strip_draw_bands(Strip *strip, ChartDatum *datum, gint age, gint x)
+{
+  GtkWidget *widget = GTK_WIDGET(strip);
+  gint k, y[CHART_QUANTILES], height = widget->allocation.height;
+
+  for (k = 0; k < CHART_QUANTILES; k++)
+    {
+      gfloat val = history_get(&datum->quantiles->band[k], age);
+
+      if (isnan(val))
+	return;
+      y[k] = val2gdk(val, datum->adj, height, datum->scale_style);
+    }
+  if (datum->envelope_gc)
+    gdk_draw_line(widget->window, datum->envelope_gc,
+      x, y[0], x, y[CHART_QUANTILES - 1]);
+  for (k = 1; k < CHART_QUANTILES; k++)
+    gdk_draw_point(widget->window,
+      datum->gdk_gc[MIN(k, datum->colors - 1)], x, y[k]);
+}
+
+/*
+ * strip_plot -- draws val at column x, joined for line plots to y0,
+ * the value drawn just to its right, if joined is set.  A gap, where
+ * the value is missing, is left blank.
+ */
+static void
+strip_plot(Strip *strip, ChartDatum *datum, gint x, gfloat val,
+  gint *y0, gboolean *joined)
+{
+  GtkWidget *widget = GTK_WIDGET(strip);
+  gint height = widget->allocation.height;
+  gint y = val2gdk(val, datum->adj, height, datum->scale_style);
+
+  if (isnan(val))
+    {
+      *joined = FALSE;
+      return;
+    }
+
+  switch (datum->plot_style)
+    {
+    default:
+    case chart_plot_point:
+      gdk_draw_point(widget->window, datum->gdk_gc[0], x, y);
+      break;
+    case chart_plot_line:
+    case chart_plot_percentile:
+      if (*joined)
+	gdk_draw_line(widget->window, datum->gdk_gc[0], x, y, x+1, *y0);
+      *y0 = y;
+      *joined = TRUE;
+      break;
+    case chart_plot_solid:
+      gdk_draw_line(widget->window, datum->gdk_gc[0],
+	x, y, x, val2gdk(0, datum->adj, height, datum->scale_style));
+      break;
+    }
+}
+
+/*
+ * strip_redraw_archive -- redraws datum from its archive, for a view
+ * panned back further than its history reaches.
+ */
+static void
+strip_redraw_archive(Strip *strip, ChartDatum *datum)
+{
+  gint x, y0 = 0, joined = FALSE, width = GTK_WIDGET(strip)->allocation.width;
+  gint64 first = (gint64)history_pack_pushed(datum->archive)
+    - strip->pan - width + 1;
+
+  if (strip->scratch_len < width)
+    {
+      strip->scratch = g_realloc(strip->scratch, width * sizeof(*strip->scratch));
+      strip->scratch_len = width;
+    }
+  for (x = 0; x < width && first + x < 1; x++)
+    strip->scratch[x] = NAN;
+  history_pack_read(datum->archive, first + x, width - x,
+    NULL, strip->scratch + x);
+
+  for (x = width - 1; x >= 0; x--)
+    strip_plot(strip, datum, x, strip->scratch[x], &y0, &joined);
+}
+
 static void
 strip_redraw(Strip *strip)
 {
-  GSList *list;
+  gint p;
+  Chart *chart = CHART(strip);
   GtkWidget *widget = GTK_WIDGET(strip);
   gint width = widget->allocation.width;
   gint height = widget->allocation.height;
 
+  strip->redraws++;
   gdk_draw_rectangle(widget->window,
     widget->style->bg_gc[GTK_WIDGET_STATE(widget)], TRUE,
     0,0, width, height);
 
-  for (list = CHART(strip)->param; list != NULL; list = g_slist_next(list))
+  for (p = 0; p < chart->params; p++)
     {
-      gint i, x, y0 = 0, points;
-      ChartDatum *datum = (ChartDatum *)list->data;
-      gint h = datum->newest;
-      ChartPlotStyle plot = datum->plot_style;
-      ChartScaleStyle scale = datum->scale_style;
+      gint i, x, y0 = 0, points, joined = FALSE;
+      ChartDatum *datum = CHART_PARAM(chart, p);
+      const History *hist = strip_history(strip, datum);
+      gint h = hist->newest;
 
       if (datum->colors == 0)
-	chart_assign_color(CHART(strip), datum);
+	chart_assign_color(chart, datum);
 
-      if (plot == chart_plot_indicator)
+      if (datum->plot_style == chart_plot_indicator)
 	continue;
 
       if (datum->colors == 0)
 	      continue;
 
-      x = width - datum->idle - 1;
-      points = datum->history_count;
+      if (strip->zoom == 0 && strip->pan && datum->archive)
+	{
+	  strip_redraw_archive(strip, datum);
+	  continue;
+	}
+
+      x = width - 1 - (strip->zoom ? 0 : CHART_HOT(datum)->idle);
+      if ((points = hist->count - strip->pan) <= 0)
+	continue;
+      if ((h -= strip->pan) < 0)
+	h += hist->size;
       for (i = 0; i < points && 0 <= x; i++)
 	{
-	  gint y = val2gdk(datum->history[h], datum->adj, height, scale);
-	  switch (plot)
+	  gfloat val = hist->values[h];
+
+	  /* A percentile plot follows its p50 where it has one, and
+	     its mean in columns from before it had quantiles. */
+	  if (strip->zoom == 0 && datum->quantiles
+	    && !isnan(history_get(&datum->quantiles->band[0], i + strip->pan)))
 	    {
-	    default:
-	    case chart_plot_point:
-	      gdk_draw_point(widget->window, datum->gdk_gc[0], x, y);
-	      break;
-	    case chart_plot_line:
-	      if (i)
-		gdk_draw_line(widget->window, datum->gdk_gc[0], x, y, x+1, y0);
-	      y0 = y;
-	      break;
-	    case chart_plot_solid:
-	      gdk_draw_line(widget->window, datum->gdk_gc[0],
-		x, y, x, val2gdk(0, datum->adj, height, scale));
-	      break;
+	      val = history_get(&datum->quantiles->band[0], i + strip->pan);
+	      strip_draw_bands(strip, datum, i + strip->pan, x);
 	    }
+	  else if (!isnan(val))
+	    strip_draw_envelope(strip, datum, hist, h, x);
+	  strip_plot(strip, datum, x, val, &y0, &joined);
 	  x--;
 	  if (--h < 0)
-	    h = datum->history_size - 1;
+	    h = hist->size - 1;
 	}
     }
 }
 
+/*
+ * strip_update_by_shifting -- scrolls the strip left by n columns and
+ * draws the n newest history entries into the gap.
+ */
 static void
-strip_update_by_shifting(Strip *strip)
+strip_update_by_shifting(Strip *strip, gint n)
 {
-  GSList *list;
+  gint p;
+  Chart *chart = CHART(strip);
   GtkWidget *widget = GTK_WIDGET(strip);
   gint width = widget->allocation.width;
   gint height = widget->allocation.height;
 
+  n = CLAMP(n, 1, width);
   gdk_draw_drawable(widget->window,
     widget->style->fg_gc[GTK_WIDGET_STATE(widget)],
-    widget->window, 1,0,0,0, width-1,height);
+    widget->window, n,0,0,0, width-n,height);
 
   gdk_draw_rectangle(widget->window,
     widget->style->bg_gc[GTK_WIDGET_STATE(widget)],
-    TRUE, width-1,0, 1,height);
+    TRUE, width-n,0, n,height);
 
-  for (list = CHART(strip)->param; list; list = g_slist_next(list))
+  for (p = 0; p < chart->params; p++)
     {
-      gint h, y, y0;
-      ChartDatum *datum = (ChartDatum *)list->data;
+      gint age, h, y, y0;
+      ChartDatum *datum = CHART_PARAM(chart, p);
       ChartPlotStyle plot = datum->plot_style;
       ChartScaleStyle scale = datum->scale_style;
 
-      if (datum->history_count == 0)
+      if (datum->history.count == 0)
 	{
-	  chart_assign_color(CHART(strip), datum);
+	  chart_assign_color(chart, datum);
 	  continue;
 	}
 
       if (plot == chart_plot_indicator)
 	continue;
 
-      h = datum->newest;
-      y = val2gdk(datum->history[h], datum->adj, height, scale);
+      if (datum->quantiles)
+	{
+	  for (age = MIN(n, datum->history.count) - 1; age >= 0; age--)
+	    {
+	      gint x = width - 1 - age;
+	      gfloat val = history_get(&datum->quantiles->band[0], age);
+	      gfloat prev = history_get(&datum->quantiles->band[0], age + 1);
+
+	      strip_draw_bands(strip, datum, age, x);
+	      if (!isnan(val) && !isnan(prev))
+		gdk_draw_line(widget->window, datum->gdk_gc[0],
+		  x-1, val2gdk(prev, datum->adj, height, scale),
+		  x, val2gdk(val, datum->adj, height, scale));
+	    }
+	  continue;
+	}
+
+      for (age = MIN(n, datum->history.count) - 1; age >= 0; age--)
+	{
+	  gint x = width - 1 - age;
+
+	  if ((h = datum->history.newest - age) < 0)
+	    h += datum->history.size;
+	  if (isnan(datum->history.values[h]))
+	    continue;
+	  y = val2gdk(datum->history.values[h], datum->adj, height, scale);
+	  strip_draw_envelope(strip, datum, &datum->history, h, x);
 
 #ifdef DEBUG
-      printf("plot %p %f (%d, %f...%f) = %d\n", datum, datum->history[h], height, datum->adj->lower, datum->adj->upper, y);
+	  printf("plot %p %f (%d, %f...%f) = %d\n", datum, datum->history.values[h], height, datum->adj->lower, datum->adj->upper, y);
 #endif
 
-      switch (plot)
-	{
-	default:
-	case chart_plot_point:
-	  gdk_draw_point(widget->window, datum->gdk_gc[0], width, y);
-	  break;
-	case chart_plot_line:
-	  if (--h < 0)
-	    h = datum->history_size - 1;
-	  y0 = val2gdk(datum->history[h], datum->adj, height, scale);
-	  gdk_draw_line(widget->window,
-	    datum->gdk_gc[0], width-2,y0, width-1,y);
-	  break;
-	case chart_plot_solid:
-	  y0 = val2gdk(0, datum->adj, height, scale);
-	  gdk_draw_line(widget->window,
-	    datum->gdk_gc[0], width-1,y, width-1,y0);
-	  break;
+	  switch (plot)
+	    {
+	    default:
+	    case chart_plot_point:
+	      gdk_draw_point(widget->window, datum->gdk_gc[0], x, y);
+	      break;
+	    case chart_plot_line:
+	      if (--h < 0)
+		h = datum->history.size - 1;
+	      if (isnan(datum->history.values[h]))
+		break;
+	      y0 = val2gdk(datum->history.values[h], datum->adj, height, scale);
+	      gdk_draw_line(widget->window,
+		datum->gdk_gc[0], x-1,y0, x,y);
+	      break;
+	    case chart_plot_solid:
+	      y0 = val2gdk(0, datum->adj, height, scale);
+	      gdk_draw_line(widget->window,
+		datum->gdk_gc[0], x,y, x,y0);
+	      break;
+	    }
 	}
     }
 }
@@ -160,22 +353,24 @@ strip_overlay_ticks(Strip *strip)
 static void
 strip_overlay_indicators(Strip *strip)
 {
-  GSList *list;
+  gint p;
+  Chart *chart = CHART(strip);
   GtkWidget *widget = GTK_WIDGET(strip);
   gint indicator_x = 0, indicator_y = 0, indicator_step = 10;
 
-  for (list = CHART(strip)->param; list; list = g_slist_next(list))
-    if (((ChartDatum *)list->data)->plot_style == chart_plot_indicator)
+  for (p = 0; p < chart->params; p++)
+    if (CHART_PARAM(chart, p)->plot_style == chart_plot_indicator)
       indicator_x += indicator_step;
 
-  for (list = CHART(strip)->param; list; list = g_slist_next(list))
+  for (p = 0; p < chart->params; p++)
     {
-      ChartDatum *datum = (ChartDatum *)list->data;
+      ChartDatum *datum = CHART_PARAM(chart, p);
       ChartPlotStyle plot = datum->plot_style;
 
       if (plot == chart_plot_indicator)
 	{
-	  gint c = datum->history[datum->newest] + 0.5;
+	  gfloat v = datum->history.values[datum->history.newest];
+	  gint c = isnan(v) ? 0 : v + 0.5;
 	  indicator_x -= indicator_step;
 	  if (c > 0)
 	    {
@@ -193,21 +388,126 @@ strip_overlay_indicators(Strip *strip)
     }
 }
 
+/*
+ * strip_budget -- steps the drawing down a level when an update took
+ * longer than the budget, or the main loop was running that late, and
+ * back up once updates have been comfortably quick for a while.  Each
+ * change of level forces a full redraw.
+ */
+static void
+strip_budget(Strip *strip, gint64 cost)
+{
+  gint64 budget = strip->budget * (gint64)1000;
+
+  if (cost > budget || strip->late > budget)
+    {
+      strip->calm = 0;
+      if (strip->degrade < STRIP_DEGRADE_MAX)
+	{
+	  strip->degrade++;
+	  strip->stale = TRUE;
+	}
+    }
+  else if (cost < budget / 2 && strip->late < budget / 2)
+    {
+      if (strip->degrade > 0 && ++strip->calm >= STRIP_CALM)
+	{
+	  strip->calm = 0;
+	  strip->degrade--;
+	  strip->stale = TRUE;
+	}
+    }
+  else
+    strip->calm = 0;
+  strip->late = 0;
+}
+
+/*
+ * strip_update -- draws the newest column.  Nothing is drawn while the
+ * strip can't be seen; history carries on regardless, and the first
+ * update once it's back in view redraws the lot.
+ *
+ * With a budget set, a strip that can't keep up sheds work a step at a
+ * time: first the tick marks, then the indicators, then it draws only
+ * every 2nd, 4th and finally 8th update, scrolling by that many
+ * columns at once.
+ *
+ * Zoomed out, the strip gains a column only once every span updates,
+ * and redraws then.  Panned back, it holds still: the columns arriving
+ * off to its right just push the view further into the past.
+ */
 static void
 strip_update(Strip *strip)
 {
   static int show_ticks = 1;
+  Chart *chart = CHART(strip);
+  gint64 start = g_get_monotonic_time();
+  gint level = strip->budget ? strip->degrade : 0;
+  gint ticks = strip->show_ticks && level < 1;
+  gint coalesce = level < 3 ? 1 : 1 << (level - 2);
+
+  /* How far behind the timer was, relative to when this update was due. */
+  if (strip->budget && strip->last_update && chart->interval)
+    {
+      gint64 late = start - strip->last_update
+	- chart->interval * (gint64)chart->column_ticks * 1000;
+      strip->late = MAX(strip->late, late);
+    }
+  strip->last_update = start;
+
+  if (++strip->columns % strip_span(strip) == 0 && strip->pan)
+    strip->pan = MIN(strip->pan + 1, strip_pan_limit(strip));
 
-  if (!show_ticks)
-    strip_update_by_shifting(strip);
+  if (!chart_viewable(chart))
+    {
+      strip->stale = TRUE;
+      strip->pending = 0;
+      return;
+    }
+
+  if (strip->pan || (strip->zoom && strip->columns % strip_span(strip)))
+    {
+      if (!strip->stale)
+	{
+	  strip->pending = 0;
+	  return;
+	}
+    }
+  else if (strip->zoom)
+    strip->stale = TRUE;	/* can't scroll by a fraction of a column */
+
+  if (++strip->pending < coalesce && !strip->stale)
+    return;
+
+  if (!show_ticks && !ticks && !strip->stale)
+    strip_update_by_shifting(strip, strip->pending);
   else
     {
       strip_redraw(strip);
-      if (strip->show_ticks)
+      if (ticks)
 	strip_overlay_ticks(strip);
     }
-  strip_overlay_indicators(strip);
-  show_ticks = strip->show_ticks;
+  if (level < 2)
+    strip_overlay_indicators(strip);
+  show_ticks = ticks;
+  strip->stale = FALSE;
+  strip->pending = 0;
+
+  if (strip->budget)
+    {
+      gdk_flush();	/* so that a slow display's round trip is counted */
+      strip_budget(strip, g_get_monotonic_time() - start);
+    }
+}
+
+/*
+ * strip_rescale -- columns already on screen were drawn to the old
+ * scale, so the next update has to redraw the lot.
+ */
+static void
+strip_rescale(Strip *strip)
+{
+  strip->stale = TRUE;
 }
 
 static gboolean
@@ -218,9 +518,46 @@ strip_expose(GtkWidget *widget, GdkEventExpose *event, void *nil)
   if (strip->show_ticks)
     strip_overlay_ticks(strip);
   strip_overlay_indicators(strip);
+  strip->stale = FALSE;
+  strip->pending = 0;
   return FALSE;
 }
 
+/*
+ * strip_scroll -- the wheel zooms the strip in and out; with shift
+ * held, or sideways, it pans back and forth by a quarter of the strip.
+ */
+static gboolean
+strip_scroll(GtkWidget *widget, GdkEventScroll *event, void *nil)
+{
+  Strip *strip = STRIP(widget);
+  gint step = MAX(widget->allocation.width / 4, 1);
+  GdkScrollDirection dir = event->direction;
+
+  if (event->state & GDK_SHIFT_MASK)
+    dir = dir == GDK_SCROLL_UP ? GDK_SCROLL_LEFT
+      : dir == GDK_SCROLL_DOWN ? GDK_SCROLL_RIGHT : dir;
+
+  switch (dir)
+    {
+    case GDK_SCROLL_UP:
+      if (strip->zoom > 0)
+	strip_set_view(strip, strip->zoom - 1, strip->pan * HISTORY_FANOUT);
+      break;
+    case GDK_SCROLL_DOWN:
+      if (strip->zoom < HISTORY_LEVELS)
+	strip_set_view(strip, strip->zoom + 1, strip->pan / HISTORY_FANOUT);
+      break;
+    case GDK_SCROLL_LEFT:
+      strip_set_view(strip, strip->zoom, strip->pan + step);
+      break;
+    case GDK_SCROLL_RIGHT:
+      strip_set_view(strip, strip->zoom, strip->pan - step);
+      break;
+    }
+  return TRUE;
+}
+
 static void
 strip_configure(GtkWidget *widget, GdkEvent *event, void *nil)
 {
@@ -241,6 +578,34 @@ strip_set_ticks(Strip *strip, gint show, gint major, gint minor)
     strip->minor_ticks = minor;
 }
 
+/*
+ * strip_set_budget -- sets how many milliseconds an update may take
+ * before the strip starts drawing less; zero draws everything always.
+ */
+void
+strip_set_budget(Strip *strip, gint msec)
+{
+  strip->budget = MAX(msec, 0);
+  strip->degrade = strip->calm = 0;
+  strip->late = 0;
+  strip->stale = TRUE;
+}
+
+/*
+ * strip_set_view -- zooms the strip out to pyramid level zoom, where
+ * each column stands for HISTORY_FANOUT to the zoom columns, and pans
+ * it back pan of those columns from the newest.  Zero for both follows
+ * the data live.
+ */
+void
+strip_set_view(Strip *strip, gint zoom, gint pan)
+{
+  strip->zoom = CLAMP(zoom, 0, HISTORY_LEVELS);
+  strip->pan = CLAMP(pan, 0, strip_pan_limit(strip));
+  strip->stale = TRUE;
+  gtk_widget_queue_draw(GTK_WIDGET(strip));
+}
+
 void
 strip_set_default_history_size(Strip *strip, gint size)
 {
@@ -255,6 +620,9 @@ strip_init(Strip *strip)
 
   g_signal_connect(strip, "expose_event", G_CALLBACK(strip_expose), NULL);
   g_signal_connect(strip, "configure_event", G_CALLBACK(strip_configure), NULL);
+  gtk_widget_add_events(GTK_WIDGET(strip), GDK_SCROLL_MASK);
+  g_signal_connect(strip, "scroll_event", G_CALLBACK(strip_scroll), NULL);
+  g_signal_connect(strip, "chart_rescale", G_CALLBACK(strip_rescale), NULL);
   g_signal_connect(strip, "chart_post_update", G_CALLBACK(strip_update), NULL);
 }
 
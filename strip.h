@@ -26,6 +26,9 @@
 #define STRIP_CLASS(klass) 		(G_TYPE_CHECK_CLASS_CAST((klass), TYPE_STRIP, StripClass))
 #define IS_STRIP_CLASS(klass) 		(G_TYPE_CHECK_CLASS_TYPE((klass), TYPE_STRIP))
 
+#define STRIP_DEGRADE_MAX	5	/* no ticks, no indicators, then 2x, 4x, 8x */
+#define STRIP_CALM		16	/* quick updates before stepping back up */
+
 typedef struct _Strip		Strip;
 typedef struct _StripClass	StripClass;
 
@@ -33,6 +36,20 @@ struct _Strip
 {
   Chart chart;
   gint show_ticks, minor_ticks, major_ticks;
+  gboolean stale;	/* updates were skipped while out of sight */
+
+  gint budget;		/* ms an update may take; 0 for no limit */
+  gint degrade, calm;	/* how much is being left out, and for how long
+			   updates have been within budget */
+  gint pending;		/* columns not yet drawn */
+  gint64 last_update, late;
+  guint redraws;	/* full ones, as opposed to scrolls */
+
+  gint zoom;		/* pyramid level shown; 0 for the history itself */
+  gint pan;		/* columns of that level back from the newest */
+  guint columns;	/* updates so far, to tell when the zoomed level grows */
+  gfloat *scratch;	/* a width of values decoded from an archive */
+  gint scratch_len;
 };
 
 struct _StripClass
@@ -45,6 +62,8 @@ GType strip_get_type(void);
 GtkWidget *strip_new(void);
 
 void strip_set_ticks(Strip *strip, gint show, gint major, gint minor);
+void strip_set_budget(Strip *strip, gint msec);
+void strip_set_view(Strip *strip, gint zoom, gint pan);
 void strip_set_default_history_size(Strip *strip, gint size);
 
 #endif /* STRIP_H */ 
@@ -0,0 +1,383 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * stripchart-query -- answers questions about a "stripchart
+ * --record-log" recording without reading it in.  The file is mapped,
+ * the batch index finds where the range asked about begins in
+ * O(log n), and a single pass over the ticks from there either sums
+ * up each parameter:
+ *
+ *	name  count  min  mean  max  p50  p95  p99
+ *
+ * or, with --every, writes them out as CSV, each row the mean of a
+ * bucket of that many seconds:
+ *
+ *	time,name,...
+ *
+ * Times are seconds since the epoch, or "YYYY-mm-dd HH:MM[:SS]" in
+ * local time.  Percentiles are good to within 1%.  A run of ticks
+ * holding the same value costs the summary no more than one tick does,
+ * so a pass over a recording runs at about the speed it can be paged in.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "reclog.h"
+#include "sketch.h"
+
+char *prog_name;
+
+static char *from_str = NULL;
+static char *to_str = NULL;
+static gdouble every = 0;
+static gboolean check = FALSE;
+static gboolean info = FALSE;
+
+static const gdouble quantile[] = { 0.50, 0.95, 0.99 };
+
+static
+GOptionEntry option_entries[] =
+{
+  { "from",            's', 0, G_OPTION_ARG_STRING, &from_str, "Start at time T", "T" },
+  { "to",              'e', 0, G_OPTION_ARG_STRING, &to_str, "Stop after time T", "T" },
+  { "every",           'n', 0, G_OPTION_ARG_DOUBLE, &every, "Write CSV of each parameter's mean over every SECONDS, rather than a summary", "SECONDS" },
+  { "check",           'c', 0, G_OPTION_ARG_NONE, &check, "Check each batch's CRC, and skip those that fail", NULL },
+  { "info",            'i', 0, G_OPTION_ARG_NONE, &info, "Describe the recording: its parameters, span and size", NULL },
+  { NULL }
+};
+
+/*
+ * Column -- a parameter being queried, and what's been gathered on
+ * it.  A run of the same value is held back, and counted all at once
+ * when it ends.
+ */
+typedef struct
+{
+  gint param;		/* in the recording */
+  guint64 count;
+  gdouble min, max, sum;
+  Sketch *sketch;
+  gfloat run;
+  guint64 run_n;
+  gdouble bucket_sum;	/* for --every */
+  guint bucket_n;
+}
+Column;
+
+static gboolean
+parse_time(const char *s, gdouble *t)
+{
+  char *e;
+  struct tm tm;
+
+  *t = g_ascii_strtod(s, &e);
+  if (e != s && *e == '\0')
+    return TRUE;
+
+  memset(&tm, 0, sizeof(tm));
+  if ((e = strptime(s, "%Y-%m-%d %H:%M", &tm)) == NULL)
+    return FALSE;
+  if (*e == ':' && (e = strptime(e, ":%S", &tm)) == NULL)
+    return FALSE;
+  if (*e != '\0')
+    return FALSE;
+  tm.tm_isdst = -1;
+  *t = mktime(&tm);
+  return TRUE;
+}
+
+static void
+column_flush(Column *col)
+{
+  if (col->run_n == 0)
+    return;
+  if (col->count == 0 || col->run < col->min)
+    col->min = col->run;
+  if (col->count == 0 || col->run > col->max)
+    col->max = col->run;
+  col->count += col->run_n;
+  col->sum += (gdouble)col->run * col->run_n;
+  sketch_add_n(col->sketch, col->run, col->run_n);
+  col->run_n = 0;
+}
+
+static inline void
+column_add(Column *col, gfloat v)
+{
+  if (!isfinite(v))
+    return;
+  if (col->run_n && v == col->run)
+    col->run_n++;
+  else
+    {
+      column_flush(col);
+      col->run = v;
+      col->run_n = 1;
+    }
+}
+
+/*
+ * csv_field -- writes a name, quoted if it needs to be.
+ */
+static void
+csv_field(FILE *out, const char *s)
+{
+  if (strpbrk(s, ",\"\n") == NULL)
+    {
+      fputs(s, out);
+      return;
+    }
+  putc('"', out);
+  for (; *s; s++)
+    {
+      if (*s == '"')
+	putc('"', out);
+      putc(*s, out);
+    }
+  putc('"', out);
+}
+
+static void
+bucket_write(FILE *out, gdouble t, Column *cols, gint ncols)
+{
+  gint c;
+
+  fprintf(out, "%.3f", t);
+  for (c = 0; c < ncols; c++)
+    {
+      if (cols[c].bucket_n)
+	fprintf(out, ",%.7g", cols[c].bucket_sum / cols[c].bucket_n);
+      else
+	putc(',', out);
+      cols[c].bucket_sum = 0;
+      cols[c].bucket_n = 0;
+    }
+  putc('\n', out);
+}
+
+/*
+ * query_scan -- the one pass: over the ticks from from to to, starting
+ * from the batch the index says holds from.
+ */
+static void
+query_scan(const Reclog_map *m, Column *cols, gint ncols,
+  gdouble from, gdouble to, FILE *out)
+{
+  guint b, i;
+  gint c;
+  gdouble bucket = 0;
+  gboolean started = FALSE;
+
+  for (b = reclog_map_seek(m, from); b < m->batches; b++)
+    {
+      const struct reclog_batch *batch = reclog_map_batch(m, b, check);
+
+      if (batch == NULL)
+	{
+	  fprintf(stderr, "%s: skipping damaged batch %u\n", prog_name, b);
+	  continue;
+	}
+      if (batch->last_t < from)
+	continue;
+      if (batch->first_t > to)
+	break;
+
+      for (i = 0; i < batch->ticks; i++)
+	{
+	  const char *tick = RECLOG_TICK(batch, m->tick_size, i);
+	  const gfloat *v = RECLOG_TICK_VALUES(tick);
+	  gdouble t = RECLOG_TICK_T(tick);
+
+	  if (t < from)
+	    continue;
+	  if (t > to)
+	    goto done;
+
+	  if (every <= 0)
+	    {
+	      for (c = 0; c < ncols; c++)
+		column_add(&cols[c], v[cols[c].param]);
+	      continue;
+	    }
+
+	  if (!started || t >= bucket + every)
+	    {
+	      if (started)
+		bucket_write(out, bucket, cols, ncols);
+	      bucket = floor(t / every) * every;
+	      started = TRUE;
+	    }
+	  for (c = 0; c < ncols; c++)
+	    if (isfinite(v[cols[c].param]))
+	      {
+		cols[c].bucket_sum += v[cols[c].param];
+		cols[c].bucket_n++;
+	      }
+	}
+    }
+
+ done:
+  if (started)
+    bucket_write(out, bucket, cols, ncols);
+}
+
+static void
+query_info(const Reclog_map *m, const char *fn)
+{
+  gint p;
+  gdouble first = 0, last = 0;
+
+  if (m->batches)
+    {
+      const struct reclog_batch *b = reclog_map_batch(m, m->batches - 1, FALSE);
+
+      first = m->index[0].first_t;
+      last = b ? b->last_t : m->index[m->batches - 1].first_t;
+    }
+  printf("%s: %d parameters, %" G_GUINT64_FORMAT " ticks in %u batches, "
+    "%.3f to %.3f (%.0f s)%s\n", fn, m->params, m->ticks, m->batches,
+    first, last, last - first, m->closed ? "" : ", not closed");
+  for (p = 0; p < m->params; p++)
+    printf("  %s\n", m->names[p]);
+}
+
+int
+main(int argc, char *argv[])
+{
+  gint c, p, ncols;
+  guint q;
+  gdouble from = -HUGE_VAL, to = HUGE_VAL;
+  GError *error = NULL;
+  GOptionContext *context;
+  Reclog_map *m;
+  Column *cols;
+  static char obuf[1 << 16];
+
+  prog_name = argv[0];
+  if (strrchr(prog_name, '/'))
+    prog_name = strrchr(prog_name, '/') + 1;
+
+  context = g_option_context_new("FILE [PARAM...]");
+  g_option_context_add_main_entries(context, option_entries, NULL);
+  if (!g_option_context_parse(context, &argc, &argv, &error))
+  {
+	  g_printerr("%s\n", error->message);
+	  g_error_free (error);
+	  return EXIT_FAILURE;
+  }
+  g_option_context_free(context);
+
+  if (argc < 2)
+    {
+      fprintf(stderr, "%s: no recording given\n", prog_name);
+      return EXIT_FAILURE;
+    }
+  if (from_str && !parse_time(from_str, &from))
+    {
+      fprintf(stderr, "%s: can't make sense of the time \"%s\"\n",
+	prog_name, from_str);
+      return EXIT_FAILURE;
+    }
+  if (to_str && !parse_time(to_str, &to))
+    {
+      fprintf(stderr, "%s: can't make sense of the time \"%s\"\n",
+	prog_name, to_str);
+      return EXIT_FAILURE;
+    }
+  if ((m = reclog_map_open(argv[1])) == NULL)
+    return EXIT_FAILURE;
+  madvise((void *)m->map, m->size, MADV_SEQUENTIAL);
+
+  if (info)
+    {
+      query_info(m, argv[1]);
+      return EXIT_SUCCESS;
+    }
+
+  /* The parameters asked for, or else all of them. */
+  ncols = argc > 2 ? argc - 2 : m->params;
+  cols = g_malloc0((ncols ? ncols : 1) * sizeof(*cols));
+  for (c = 0; c < ncols; c++)
+    {
+      if (argc > 2)
+	{
+	  for (p = 0; p < m->params; p++)
+	    if (strcmp(m->names[p], argv[c + 2]) == 0)
+	      break;
+	  if (p == m->params)
+	    {
+	      fprintf(stderr, "%s: \"%s\" isn't in the recording\n",
+		prog_name, argv[c + 2]);
+	      return EXIT_FAILURE;
+	    }
+	}
+      else
+	p = c;
+      cols[c].param = p;
+      if (every <= 0)
+	{
+	  cols[c].sketch = g_malloc0(sizeof(Sketch));
+	  sketch_clear(cols[c].sketch);
+	}
+    }
+
+  setvbuf(stdout, obuf, _IOFBF, sizeof(obuf));
+  if (every > 0)
+    {
+      fputs("time", stdout);
+      for (c = 0; c < ncols; c++)
+	{
+	  putchar(',');
+	  csv_field(stdout, m->names[cols[c].param]);
+	}
+      putchar('\n');
+    }
+
+  query_scan(m, cols, ncols, from, to, stdout);
+
+  if (every <= 0)
+    {
+      printf("%-24s %12s %12s %12s %12s %12s %12s %12s\n",
+	"name", "count", "min", "mean", "max", "p50", "p95", "p99");
+      for (c = 0; c < ncols; c++)
+	{
+	  Column *col = &cols[c];
+
+	  column_flush(col);
+	  printf("%-24s %12" G_GUINT64_FORMAT, m->names[col->param], col->count);
+	  if (col->count == 0)
+	    {
+	      putchar('\n');
+	      continue;
+	    }
+	  printf(" %12.6g %12.6g %12.6g", col->min, col->sum / col->count, col->max);
+	  for (q = 0; q < G_N_ELEMENTS(quantile); q++)
+	    printf(" %12.6g", sketch_quantile(col->sketch, quantile[q]));
+	  putchar('\n');
+	}
+    }
+
+  fflush(stdout);
+  reclog_map_close(m);
+  return EXIT_SUCCESS;
+}
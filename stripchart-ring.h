@@ -0,0 +1,167 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * stripchart-ring.h -- a shared-memory ring for feeding samples to
+ * "stripchart --ring NAME".  This header is all a producer needs:
+ *
+ *	struct sc_ring *ring = sc_ring_create("/mybench", 1 << 16);
+ *	sc_ring_name(ring, 0, "requests");
+ *	...
+ *	sc_ring_push(ring, 0, now, value);	(now in Unix seconds)
+ *
+ * and a stripchart parameter whose filename is "@requests" and whose
+ * equation is "$1" plots the values.  Link with -lrt on older libcs.
+ *
+ * The segment holds a header, a table mapping series ids to names,
+ * and a power-of-two array of (id, time, value) records.  There is a
+ * single producer, which owns head, the count of records ever written.
+ * A push is a release fence, three plain stores and a release store
+ * of head: no syscalls, no locks, and no waiting on the reader.  The reader keeps
+ * its own position; if the producer laps it, the oldest records are
+ * lost, and any record the producer may be overwriting while it is
+ * being read is discarded rather than torn.
+ */
+
+#ifndef STRIPCHART_RING_H
+#define STRIPCHART_RING_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define SC_RING_MAGIC	0x53435247	/* "SCRG" */
+#define SC_RING_VERSION	1
+#define SC_RING_SERIES	256		/* series ids are 0..255 */
+#define SC_RING_NAMELEN	48
+
+struct sc_ring_record
+{
+  uint32_t id, pad;
+  double t, value;
+};
+
+struct sc_ring
+{
+  uint32_t magic, version;
+  uint32_t capacity;			/* records; a power of two */
+  uint32_t pad;
+  char names[SC_RING_SERIES][SC_RING_NAMELEN];
+  uint64_t head __attribute__((aligned(64)));
+  char pad2[64 - sizeof(uint64_t)];
+  struct sc_ring_record rec[];
+};
+
+/*
+ * sc_ring_size -- bytes in a segment of capacity records, or 0 if
+ * that won't fit in a size_t.
+ */
+static inline size_t
+sc_ring_size(uint32_t capacity)
+{
+  if (capacity > (SIZE_MAX - sizeof(struct sc_ring)) / sizeof(struct sc_ring_record))
+    return 0;
+  return sizeof(struct sc_ring) + (size_t)capacity * sizeof(struct sc_ring_record);
+}
+
+/*
+ * sc_ring_create -- creates (or re-creates) the named segment and
+ * maps it.  capacity is rounded up to a power of two.  Returns NULL,
+ * with errno set, on failure.
+ */
+static inline struct sc_ring *
+sc_ring_create(const char *shm_name, uint32_t capacity)
+{
+  int fd;
+  uint32_t cap = 1;
+  struct sc_ring *ring;
+
+  while (cap < capacity && cap < UINT32_C(1) << 31)
+    cap <<= 1;
+  if (cap < capacity || sc_ring_size(cap) == 0)
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+
+  shm_unlink(shm_name);
+  if ((fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, 0644)) < 0)
+    return NULL;
+  if (ftruncate(fd, sc_ring_size(cap)) < 0)
+    {
+      close(fd);
+      return NULL;
+    }
+  ring = mmap(NULL, sc_ring_size(cap), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ring == MAP_FAILED)
+    return NULL;
+
+  ring->capacity = cap;
+  ring->version = SC_RING_VERSION;
+  ring->head = 0;
+  __atomic_store_n(&ring->magic, SC_RING_MAGIC, __ATOMIC_RELEASE);
+  return ring;
+}
+
+/*
+ * sc_ring_name -- gives series id its name.  Call it before the first
+ * sc_ring_push for that id.
+ */
+static inline int
+sc_ring_name(struct sc_ring *ring, uint32_t id, const char *name)
+{
+  if (id >= SC_RING_SERIES || strlen(name) >= SC_RING_NAMELEN)
+    return -1;
+  strcpy(ring->names[id], name);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  return 0;
+}
+
+/*
+ * sc_ring_push -- appends one sample taken at t, in seconds since the
+ * Unix epoch (CLOCK_REALTIME, not CLOCK_MONOTONIC).  Single producer
+ * only.
+ */
+static inline void
+sc_ring_push(struct sc_ring *ring, uint32_t id, double t, double value)
+{
+  uint64_t h = ring->head;
+  struct sc_ring_record *rec = &ring->rec[h & (ring->capacity - 1)];
+
+  /*
+   * Keep these stores from showing before the last push's head: a
+   * reader that sees any of them must then see head move on, and so
+   * knows the record it holds from this slot may be torn.
+   */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  rec->id = id;
+  rec->t = t;
+  rec->value = value;
+  __atomic_store_n(&ring->head, h + 1, __ATOMIC_RELEASE);
+}
+
+static inline void
+sc_ring_close(struct sc_ring *ring)
+{
+  munmap(ring, sc_ring_size(ring->capacity));
+}
+
+#endif /* STRIPCHART_RING_H */
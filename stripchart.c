@@ -21,12 +21,49 @@
 char *prog_name;
 char *config_fn = NULL;
 const char *geometry = NULL;
+static const char *input_fn = NULL;
+static const char *listen_addr = NULL;
+static const char *ring_name = NULL;
+static gint profile_samples = 0;
+char *attach_path = NULL;
+char *history_dir = NULL;
+gdouble retain_hours = 0;
+char *record_dir = NULL;
+gdouble record_hz = 100;
+gdouble record_seconds = 5;
+char *record_log = NULL;
+char *replay_fn = NULL;
+gdouble replay_speed = 0;
+static gint profile_pack = 0;
+static gint profile_soak = 0;
+
+static gboolean
+on_attach_option(const gchar *name, const gchar *value, gpointer data, GError **err)
+{
+  attach_path = g_strdup(value ? value : default_socket_path());
+  return TRUE;
+}
 
 static
 GOptionEntry option_entries[] =
 {
   { "geometry",        'g', 0, G_OPTION_ARG_STRING, &geometry, "Geometry string: WxH+X+Y", "GEO" },
   { "config-file",     'f', 0, G_OPTION_ARG_FILENAME, &config_fn, "Configuration file name", "FILE" },
+  { "input",           'i', 0, G_OPTION_ARG_FILENAME, &input_fn, "Read pushed \"name value [unix-time]\" records from a file, FIFO, or - for stdin", "FILE" },
+  { "listen",          'l', 0, G_OPTION_ARG_STRING, &listen_addr, "Accept statsd \"name:value|g\" and \"|c\" datagrams on a UDP [HOST:]PORT or Unix socket path", "ADDR" },
+  { "ring",            'r', 0, G_OPTION_ARG_STRING, &ring_name, "Consume samples from a stripchart-ring.h shared-memory segment", "NAME" },
+  { "attach",          'a', G_OPTION_FLAG_OPTIONAL_ARG, G_OPTION_ARG_CALLBACK, on_attach_option, "Plot what a stripchartd collector is sampling rather than sampling here", "SOCKET" },
+  { "history-dir",     'H', 0, G_OPTION_ARG_FILENAME, &history_dir, "Keep each parameter's history in a file under DIR, and pick it back up on restart", "DIR" },
+  { "retain",          0,   0, G_OPTION_ARG_DOUBLE, &retain_hours, "Archive HOURS of each parameter's history, compressed, to pan back through", "HOURS" },
+  { "record",          0,   0, G_OPTION_ARG_FILENAME, &record_dir, "Sample parameters marked <record> or <trigger> at a high rate, and save the seconds around each trigger under DIR", "DIR" },
+  { "record-rate",     0,   0, G_OPTION_ARG_DOUBLE, &record_hz, "Flight recorder samples per second (100)", "HZ" },
+  { "record-window",   0,   0, G_OPTION_ARG_DOUBLE, &record_seconds, "Seconds the flight recorder saves either side of a trigger (5)", "SECONDS" },
+  { "record-log",      0,   0, G_OPTION_ARG_FILENAME, &record_log, "Append every tick's values of all parameters to a binary recording, FILE", "FILE" },
+  { "replay",          0,   0, G_OPTION_ARG_FILENAME, &replay_fn, "Play a --record-log recording into the chart instead of sampling, flat out, then report how long it took and exit", "FILE" },
+  { "speed",           0,   0, G_OPTION_ARG_DOUBLE, &replay_speed, "Replay at N times the pace it was recorded at, and stay open afterwards", "N" },
+  { "profile-sources", 0,   0, G_OPTION_ARG_INT, &profile_samples, "Sample each parameter N times without a display, report costs and exit", "N" },
+  { "profile-history", 0,   0, G_OPTION_ARG_INT, &profile_pack, "Compress N synthetic samples of several kinds of series, report sizes and speeds and exit", "N" },
+  { "profile-edits",   0,   0, G_OPTION_ARG_INT, &profile_soak, "Re-apply the config's parameters N times to a hidden chart, check that memory stays flat and exit", "N" },
   { NULL }
 };
 
@@ -35,19 +72,49 @@ main(int argc, char *argv[])
 {
   Chart_app *app;
   GError *error = NULL;
+  GOptionContext *context;
 
   prog_name = argv[0];
   if (strrchr(prog_name, '/'))
     prog_name = strrchr(prog_name, '/') + 1;
 
-  if (!gtk_init_with_args(&argc, &argv, NULL, option_entries, NULL, &error))
+  /* Parse options without opening the display, so that the headless
+     modes can run where there's no X server. */
+  context = g_option_context_new(NULL);
+  g_option_context_add_main_entries(context, option_entries, NULL);
+  g_option_context_add_group(context, gtk_get_option_group(FALSE));
+  if (!g_option_context_parse(context, &argc, &argv, &error))
   {
 	  g_printerr("%s\n", error->message);
 	  g_error_free (error);
 	  return EXIT_FAILURE;
   }
+  g_option_context_free(context);
+
+  if (profile_samples > 0)
+    return profile_sources(config_file_find(config_fn), profile_samples);
+  if (profile_pack > 0)
+    return profile_history(profile_pack);
+
+  if (!gtk_init_check(&argc, &argv))
+  {
+	  g_printerr("%s: cannot open display\n", prog_name);
+	  return EXIT_FAILURE;
+  }
+
+  if (profile_soak > 0)
+    return profile_edits(config_file_find(config_fn), profile_soak);
+
+  if (input_fn && !push_open_stream(input_fn))
+    return EXIT_FAILURE;
+  if (listen_addr && !push_listen(listen_addr))
+    return EXIT_FAILURE;
+  if (ring_name && !push_attach_ring(ring_name))
+    return EXIT_FAILURE;
 
   app = chart_app_new();
+  if ((record_log && app->reclog == NULL) || (replay_fn && app->replay == NULL))
+    return EXIT_FAILURE;
   app->frame = gtk_window_new(GTK_WINDOW_TOPLEVEL);
   gtk_window_set_title(GTK_WINDOW(app->frame), "Stripchart");
   gtk_window_set_default_size(GTK_WINDOW(app->frame), 360, 50);
@@ -65,5 +132,7 @@ main(int argc, char *argv[])
     "popup-menu", G_CALLBACK(on_popup_menu), app);
 
   gtk_main();
+  if (app->reclog)
+    reclog_close(app->reclog);
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,414 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * stripchartd -- samples a stripchart config's parameters without a
+ * display, keeps their history, and serves it to any number of
+ * "stripchart --attach" viewers over a Unix stream socket.
+ *
+ * The protocol is line-oriented text, sent one way only.  A viewer
+ * that connects gets:
+ *
+ *	stripchartd 2 <interval-ms> <nparams>
+ *	param <id> <name>			(one per parameter)
+ *	history <id> <count> <t> <v>...		(oldest first, one per parameter)
+ *	end
+ *
+ * followed by one line per sampling tick for as long as it stays:
+ *
+ *	tick <unix-time> <v0> <v1> ... <v(nparams-1)>
+ *
+ * Times are in seconds since the epoch; a history's are when each
+ * value was read.  Parameters whose equations don't compile are
+ * listed, and report nan.
+ * Parameters with an <interval> repeat their last sample in between.
+ * A viewer that falls more than VIEWER_BACKLOG bytes behind is dropped.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "utils.h"
+#include "ingest.h"
+#include "expr.h"
+#include "history.h"
+#include "wheel.h"
+#include "tick.h"
+
+#define VIEWER_BACKLOG (4 << 20)
+
+char *prog_name;
+
+static char *config_fn = NULL;
+static char *socket_path = NULL;
+static char *input_fn = NULL;
+static char *listen_addr = NULL;
+static char *ring_name = NULL;
+static gint history_size = 4096;
+
+static
+GOptionEntry option_entries[] =
+{
+  { "config-file",     'f', 0, G_OPTION_ARG_FILENAME, &config_fn, "Configuration file name", "FILE" },
+  { "socket",          's', 0, G_OPTION_ARG_FILENAME, &socket_path, "Unix socket to serve viewers on", "PATH" },
+  { "history",         'n', 0, G_OPTION_ARG_INT, &history_size, "Samples of history to keep per parameter", "N" },
+  { "input",           'i', 0, G_OPTION_ARG_FILENAME, &input_fn, "Read pushed \"name value [unix-time]\" records from a file, FIFO, or - for stdin", "FILE" },
+  { "listen",          'l', 0, G_OPTION_ARG_STRING, &listen_addr, "Accept statsd datagrams on a UDP [HOST:]PORT or Unix socket path", "ADDR" },
+  { "ring",            'r', 0, G_OPTION_ARG_STRING, &ring_name, "Consume samples from a stripchart-ring.h shared-memory segment", "NAME" },
+  { NULL }
+};
+
+/*
+ * Collected -- one parameter's sampler and history.
+ */
+typedef struct
+{
+  char *name;
+  Expr *expr;
+  gint every;		/* ticks between samples */
+  Adaptive adapt;
+  gdouble last, last_t;		/* held between samples */
+  Wheel_timer timer;
+  History history;
+}
+Collected;
+
+typedef struct
+{
+  int fd;
+  guint watch;
+  GString *out;
+}
+Viewer;
+
+static Param_group group;
+static Collected *params;
+static gint nparams;
+static gint warmup = 2;	/* the first two passes only prime ~ deltas */
+static Wheel wheel;
+static GSList *viewers;
+static GMainLoop *loop;
+
+static void
+viewer_drop(Viewer *v)
+{
+  viewers = g_slist_remove(viewers, v);
+  if (v->watch)
+    g_source_remove(v->watch);
+  close(v->fd);
+  g_string_free(v->out, TRUE);
+  g_free(v);
+}
+
+/*
+ * viewer_flush -- writes as much queued output as the socket will
+ * take.  Returns FALSE if the viewer has gone away.
+ */
+static gboolean
+viewer_flush(Viewer *v)
+{
+  while (v->out->len)
+    {
+      ssize_t n = write(v->fd, v->out->str, v->out->len);
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n < 0 && errno == EAGAIN)
+	break;
+      if (n <= 0)
+	return FALSE;
+      g_string_erase(v->out, 0, n);
+    }
+  return TRUE;
+}
+
+static gboolean viewer_event(GIOChannel *chan, GIOCondition cond, Viewer *v);
+
+static void
+viewer_send(Viewer *v)
+{
+  GIOChannel *chan;
+
+  if (!viewer_flush(v) || v->out->len > VIEWER_BACKLOG)
+    {
+      viewer_drop(v);
+      return;
+    }
+  if (v->watch)
+    g_source_remove(v->watch);
+  chan = g_io_channel_unix_new(v->fd);
+  v->watch = g_io_add_watch(chan,
+    G_IO_IN | G_IO_HUP | G_IO_ERR | (v->out->len ? G_IO_OUT : 0),
+    (GIOFunc)viewer_event, v);
+  g_io_channel_unref(chan);
+}
+
+/*
+ * viewer_event -- viewers never send anything, so readability means
+ * they've hung up; writability means there's room for more backlog.
+ */
+static gboolean
+viewer_event(GIOChannel *chan, GIOCondition cond, Viewer *v)
+{
+  if (cond & (G_IO_IN | G_IO_HUP | G_IO_ERR))
+    {
+      char buf[256];
+      if (read(v->fd, buf, sizeof(buf)) <= 0)
+	{
+	  v->watch = 0;
+	  viewer_drop(v);
+	  return FALSE;
+	}
+    }
+  if ((cond & G_IO_OUT) && v->out->len)
+    {
+      if (!viewer_flush(v))
+	{
+	  v->watch = 0;
+	  viewer_drop(v);
+	  return FALSE;
+	}
+      if (v->out->len == 0)
+	{
+	  v->watch = 0;
+	  viewer_send(v);
+	  return FALSE;
+	}
+    }
+  return TRUE;
+}
+
+static void
+append_value(GString *out, gdouble val)
+{
+  char buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  g_string_append_c(out, ' ');
+  if (isfinite(val))
+    g_string_append(out, g_ascii_formatd(buf, sizeof(buf), "%.9g", val));
+  else
+    g_string_append(out, "nan");
+}
+
+/*
+ * on_viewer -- greets a new viewer with the parameter list and
+ * everything in the histories so far.
+ */
+static gboolean
+on_viewer(GIOChannel *chan, GIOCondition cond, gpointer nil)
+{
+  int p, i, fd = accept(g_io_channel_unix_get_fd(chan), NULL, NULL);
+  Viewer *v;
+
+  if (fd < 0)
+    return TRUE;
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  v = g_malloc0(sizeof(*v));
+  v->fd = fd;
+  v->out = g_string_new(NULL);
+  viewers = g_slist_prepend(viewers, v);
+
+  g_string_append_printf(v->out, "stripchartd 2 %d %d\n", group.interval, nparams);
+  for (p = 0; p < nparams; p++)
+    g_string_append_printf(v->out, "param %d %s\n", p, params[p].name);
+  for (p = 0; p < nparams; p++)
+    {
+      History *hist = &params[p].history;
+      g_string_append_printf(v->out, "history %d %d", p, hist->count);
+      for (i = hist->count - 1; i >= 0; i--)
+	{
+	  append_value(v->out, history_get_time(hist, i));
+	  append_value(v->out, history_get(hist, i));
+	}
+      g_string_append_c(v->out, '\n');
+    }
+  g_string_append(v->out, "end\n");
+
+  viewer_send(v);
+  return TRUE;
+}
+
+/*
+ * on_tick -- samples every parameter and sends the new column out.
+ */
+static gboolean
+on_tick(gpointer nil)
+{
+  int p;
+  GSList *list, *next, *due;
+  GString *line = g_string_new(NULL);
+
+  param_group_tick(&group);
+  g_string_append_printf(line, "tick %.6f",
+    group.t_now.tv_sec + group.t_now.tv_usec / 1e6);
+
+  due = wheel_advance(&wheel);
+  for (list = due; list != NULL; list = g_slist_next(list))
+    {
+      Collected *c = ((Wheel_timer *)list->data)->data;
+      c->last = evaluate_equation(c->expr);
+      if ((c->last_t = expr_time(c->expr)) == 0)
+	c->last_t = g_get_real_time() / 1e6;
+      wheel_add(&wheel, &c->timer,
+	warmup ? 1 : c->every * adaptive_next(&c->adapt, c->last));
+    }
+  g_slist_free(due);
+
+  for (p = 0; p < nparams; p++)
+    {
+      if (!warmup)
+	history_push(&params[p].history, params[p].last_t, params[p].last);
+      append_value(line, params[p].last);
+    }
+  g_string_append_c(line, '\n');
+
+  if (warmup)
+    warmup--;
+  else
+    for (list = viewers; list != NULL; list = next)
+      {
+	Viewer *v = list->data;
+	next = g_slist_next(list);
+	g_string_append_len(v->out, line->str, line->len);
+	viewer_send(v);
+      }
+
+  g_string_free(line, TRUE);
+  return TRUE;
+}
+
+static void
+on_signal(int sig)
+{
+  g_main_loop_quit(loop);
+}
+
+static int
+serve(const char *path)
+{
+  int fd;
+  struct sockaddr_un sun;
+  GIOChannel *chan;
+
+  memset(&sun, 0, sizeof(sun));
+  sun.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(sun.sun_path))
+    {
+      fprintf(stderr, "%s: socket path too long: %s\n", prog_name, path);
+      return -1;
+    }
+  strcpy(sun.sun_path, path);
+  unlink(path);
+
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+    || bind(fd, (struct sockaddr *)&sun, sizeof(sun)) < 0
+    || listen(fd, 16) < 0)
+    {
+      fprintf(stderr, "%s: can't serve on %s: %s\n",
+	prog_name, path, strerror(errno));
+      return -1;
+    }
+
+  chan = g_io_channel_unix_new(fd);
+  g_io_add_watch(chan, G_IO_IN, on_viewer, NULL);
+  g_io_channel_unref(chan);
+  return fd;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int p;
+  const char *fn;
+  Param_desc **desc;
+  GError *error = NULL;
+  GOptionContext *context;
+
+  prog_name = argv[0];
+  if (strrchr(prog_name, '/'))
+    prog_name = strrchr(prog_name, '/') + 1;
+
+  context = g_option_context_new(NULL);
+  g_option_context_add_main_entries(context, option_entries, NULL);
+  if (!g_option_context_parse(context, &argc, &argv, &error))
+  {
+	  g_printerr("%s\n", error->message);
+	  g_error_free (error);
+	  return EXIT_FAILURE;
+  }
+  g_option_context_free(context);
+
+  if ((fn = config_file_find(config_fn)) == NULL)
+    {
+      fprintf(stderr, "%s: no config file found\n", prog_name);
+      return EXIT_FAILURE;
+    }
+  if ((desc = param_desc_ingest(fn)) == NULL)
+    return EXIT_FAILURE;
+
+  group.filter = 0.5;
+  group.interval = 5000;
+  param_group_ingest(&group, fn);
+  gettimeofday(&group.t_now, NULL);
+
+  if (input_fn && !push_open_stream(input_fn))
+    return EXIT_FAILURE;
+  if (listen_addr && !push_listen(listen_addr))
+    return EXIT_FAILURE;
+  if (ring_name && !push_attach_ring(ring_name))
+    return EXIT_FAILURE;
+
+  for (nparams = 0; desc[nparams]; nparams++)
+    ;
+  params = g_malloc0((nparams ? nparams : 1) * sizeof(*params));
+  for (p = 0; p < nparams; p++)
+    {
+      params[p].name = g_strdup(desc[p]->name ? desc[p]->name : "");
+      params[p].expr = expr_compile(&group, desc[p]);
+      params[p].every = MAX(str_to_gdouble(desc[p]->interval, 1), 1);
+      adaptive_init(&params[p].adapt, desc[p]->adaptive);
+      params[p].last = NAN;
+      params[p].timer.data = &params[p];
+      if (params[p].expr)
+	wheel_add(&wheel, &params[p].timer, 1);
+      history_init(&params[p].history, history_size);
+    }
+
+  if (socket_path == NULL)
+    socket_path = g_strdup(default_socket_path());
+  if (serve(socket_path) < 0)
+    return EXIT_FAILURE;
+
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  tick_add(group.interval, group.align, on_tick, NULL);
+  loop = g_main_loop_new(NULL, FALSE);
+  g_main_loop_run(loop);
+
+  unlink(socket_path);
+  return EXIT_SUCCESS;
+}
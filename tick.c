@@ -0,0 +1,74 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "tick.h"
+
+/*
+ * Tick_source -- a main-loop source that fires on absolute deadlines
+ * of the monotonic clock.  Unlike g_timeout_add, which schedules each
+ * wakeup relative to the last dispatch, lateness doesn't accumulate:
+ * the nth tick is due at start + n * interval however late the ones
+ * before it ran, and ticks missed altogether are skipped rather than
+ * run back to back.
+ */
+typedef struct
+{
+  GSource source;
+  gint64 interval, deadline;	/* in microseconds */
+}
+Tick_source;
+
+static gboolean
+tick_dispatch(GSource *source, GSourceFunc func, gpointer data)
+{
+  Tick_source *ts = (Tick_source *)source;
+  gint64 now = g_get_monotonic_time();
+
+  ts->deadline += ts->interval;
+  if (ts->deadline <= now)
+    ts->deadline += ((now - ts->deadline) / ts->interval + 1) * ts->interval;
+  g_source_set_ready_time(source, ts->deadline);
+
+  return func(data);
+}
+
+static GSourceFuncs tick_funcs = { NULL, NULL, tick_dispatch, NULL };
+
+/*
+ * tick_add -- calls func every msec milliseconds until it returns
+ * FALSE, like g_timeout_add.  With align, ticks fall on multiples of
+ * the interval in wall-clock time, so that separate instances sampling
+ * at the same rate do so in step.
+ */
+guint
+tick_add(guint msec, gboolean align, GSourceFunc func, gpointer data)
+{
+  guint id;
+  GSource *source = g_source_new(&tick_funcs, sizeof(Tick_source));
+  Tick_source *ts = (Tick_source *)source;
+
+  ts->interval = MAX(msec, 1) * (gint64)1000;
+  ts->deadline = g_get_monotonic_time() + ts->interval;
+  if (align)
+    ts->deadline -= g_get_real_time() % ts->interval;
+
+  g_source_set_ready_time(source, ts->deadline);
+  g_source_set_callback(source, func, data, NULL);
+  id = g_source_attach(source, NULL);
+  g_source_unref(source);
+  return id;
+}
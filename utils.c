@@ -15,9 +15,15 @@
  * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 
-#include "chart-app.h"
 #include <ctype.h>
+#include <stdio.h>
 #include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+static void (*error_handler)(const char *msg);
 
 /*
  * streq -- case-blind string comparison returning true on equality.
@@ -46,13 +52,22 @@ verror(char *msg, va_list args)
   fflush(stdout);
   fprintf(stderr, "%s: %s\n", prog_name, err_msg);
 
-  GtkWidget *dialog = gtk_message_dialog_new(NULL, GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK, "%s", err_msg);
-  gtk_dialog_run(GTK_DIALOG(dialog));
-  gtk_widget_destroy(dialog);
+  if (error_handler)
+    error_handler(err_msg);
 
   return err_msg;
 }
 
+/*
+ * error_set_handler -- installs a hook to show errors to the user
+ * beyond stderr, such as the GUI's message dialog.
+ */
+void
+error_set_handler(void (*handler)(const char *msg))
+{
+  error_handler = handler;
+}
+
 const char *
 error(char *msg, ...)
 {
@@ -66,30 +81,6 @@ error(char *msg, ...)
   return err_msg;
 }
 
-ChartPlotStyle
-str_to_plot_style(const char *style_name)
-{
-  if (streq(style_name, "indicator"))
-    return chart_plot_indicator;
-  if (streq(style_name, "point"))
-    return chart_plot_point;
-  if (streq(style_name, "line"))
-    return chart_plot_line;
-  if (streq(style_name, "solid"))
-    return chart_plot_solid;
-  return chart_plot_line;
-}
-
-ChartScaleStyle
-str_to_scale_style(const char *style_name)
-{
-  if (streq(style_name, "linear"))
-    return chart_scale_linear;
-  if (streq(style_name, "log"))
-    return chart_scale_log;
-  return chart_scale_linear;
-}
-
 gdouble
 str_to_gdouble(const char *str, gdouble fallback)
 {
@@ -103,3 +94,23 @@ str_to_gdouble(const char *str, gdouble fallback)
 	  return fallback;
   return value;
 }
+
+/*
+ * default_socket_path -- where stripchartd serves, and where
+ * "stripchart --attach" looks, when no socket is named.
+ */
+const char *
+default_socket_path(void)
+{
+  static char *path;
+
+  if (path == NULL)
+    {
+      const char *dir = g_getenv("XDG_RUNTIME_DIR");
+      if (dir && *dir)
+	path = g_build_filename(dir, "stripchartd.sock", NULL);
+      else
+	path = g_strdup_printf("/tmp/stripchartd-%u.sock", (unsigned)getuid());
+    }
+  return path;
+}
@@ -18,15 +18,20 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stdarg.h>
+#include <glib.h>
+#include <libxml/xmlstring.h>
+
+extern char *prog_name;
+
 gboolean streq(const char *s1, const char *s2);
 gboolean xmlstreq(const xmlChar *s1, const char *s2);
 
 const char *verror(char *msg, va_list args);
 const char *error(char *msg, ...) __attribute__((format (printf, 1, 2)));
-
-ChartPlotStyle str_to_plot_style(const char *style_name);
-ChartScaleStyle str_to_scale_style(const char *style_name);
+void error_set_handler(void (*handler)(const char *msg));
 
 gdouble str_to_gdouble(const char *double_string, gdouble fallback);
+const char *default_socket_path(void);
 
 #endif /* UTILS_H */
@@ -0,0 +1,145 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <math.h>
+
+#include "wheel.h"
+
+static void
+wheel_insert(Wheel *wheel, Wheel_timer *timer)
+{
+  if (timer->due - wheel->now < WHEEL_SLOTS)
+    {
+      timer->level = 0;
+      timer->slot = timer->due & (WHEEL_SLOTS - 1);
+    }
+  else
+    {
+      timer->level = 1;
+      timer->slot = (timer->due >> WHEEL_BITS) & (WHEEL_SLOTS - 1);
+    }
+  wheel->slot[timer->level][timer->slot] =
+    g_slist_prepend(wheel->slot[timer->level][timer->slot], timer);
+}
+
+/*
+ * wheel_add -- schedules timer to come due delay ticks from now.  A
+ * delay of zero is taken as one: the current tick has already gone.
+ */
+void
+wheel_add(Wheel *wheel, Wheel_timer *timer, guint delay)
+{
+  timer->due = wheel->now + MAX(delay, 1);
+  wheel_insert(wheel, timer);
+}
+
+/*
+ * wheel_remove -- unschedules a timer that hasn't come due yet.  It's
+ * harmless to call for one that already has.
+ */
+void
+wheel_remove(Wheel *wheel, Wheel_timer *timer)
+{
+  wheel->slot[timer->level][timer->slot] =
+    g_slist_remove(wheel->slot[timer->level][timer->slot], timer);
+}
+
+/*
+ * wheel_advance -- moves on a tick and returns the timers due on it,
+ * which are no longer scheduled.  The caller frees the list.
+ */
+GSList *
+wheel_advance(Wheel *wheel)
+{
+  GSList *due;
+
+  wheel->now++;
+  if ((wheel->now & (WHEEL_SLOTS - 1)) == 0)
+    {
+      gint s = (wheel->now >> WHEEL_BITS) & (WHEEL_SLOTS - 1);
+      GSList *list, *cascade = wheel->slot[1][s];
+
+      wheel->slot[1][s] = NULL;
+      for (list = cascade; list != NULL; list = g_slist_next(list))
+	wheel_insert(wheel, list->data);
+      g_slist_free(cascade);
+    }
+
+  due = wheel->slot[0][wheel->now & (WHEEL_SLOTS - 1)];
+  wheel->slot[0][wheel->now & (WHEEL_SLOTS - 1)] = NULL;
+  return due;
+}
+
+/*
+ * adaptive_init -- sets up adaptive sampling from a "TOLERANCE [LOW
+ * HIGH]" spec; with no spec, or a tolerance that isn't positive, the
+ * parameter is always sampled at full rate.
+ */
+void
+adaptive_init(Adaptive *ad, const char *spec)
+{
+  char *e;
+
+  ad->on = FALSE;
+  ad->low = -G_MAXDOUBLE;
+  ad->high = G_MAXDOUBLE;
+  ad->ref = NAN;
+  ad->flat = 0;
+  ad->stretch = 1;
+
+  if (spec == NULL)
+    return;
+  ad->tolerance = g_ascii_strtod(spec, &e);
+  if (e == spec || !(ad->tolerance > 0))
+    return;
+  ad->on = TRUE;
+
+  spec = e;
+  ad->low = g_ascii_strtod(spec, &e);
+  if (e == spec)
+    ad->low = -G_MAXDOUBLE;
+  spec = e;
+  ad->high = g_ascii_strtod(spec, &e);
+  if (e == spec)
+    ad->high = G_MAXDOUBLE;
+}
+
+/*
+ * adaptive_next -- takes in a fresh sample and returns the multiple of
+ * the parameter's interval to wait before the next one.
+ */
+gint
+adaptive_next(Adaptive *ad, gdouble val)
+{
+  if (!ad->on)
+    return 1;
+
+  if (!isfinite(val) || !isfinite(ad->ref)
+    || val < ad->low || ad->high < val
+    || fabs(val - ad->ref) > ad->tolerance)
+    {
+      ad->ref = val;
+      ad->flat = 0;
+      ad->stretch = 1;
+    }
+  else if (++ad->flat >= ADAPTIVE_RUN && ad->stretch < ADAPTIVE_MAX)
+    {
+      ad->flat = 0;
+      ad->stretch *= 2;
+    }
+  return ad->stretch;
+}
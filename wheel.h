@@ -0,0 +1,75 @@
+/* Stripchart -- the gnome-utils stripchart plotting utility
+ * Copyright (C) 2000 John Kodis <kodis@jagunet.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include <glib.h>
+
+#define WHEEL_BITS	6
+#define WHEEL_SLOTS	(1 << WHEEL_BITS)
+
+/*
+ * Wheel -- a two-level hierarchical timer wheel counting in ticks.
+ * Level 0 has a slot for each of the next WHEEL_SLOTS ticks; level 1
+ * has a slot for each WHEEL_SLOTS-tick span beyond that, which is
+ * emptied down into level 0 when its span comes round.  Advancing a
+ * tick touches only the timers due on it (and, once every WHEEL_SLOTS
+ * ticks, those cascading down), however many are waiting.
+ */
+typedef struct
+{
+  guint64 due;
+  gint level, slot;
+  gpointer data;
+}
+Wheel_timer;
+
+typedef struct
+{
+  guint64 now;
+  GSList *slot[2][WHEEL_SLOTS];
+}
+Wheel;
+
+#define ADAPTIVE_RUN	8	/* flat samples before backing off further */
+#define ADAPTIVE_MAX	16	/* the most an interval is stretched */
+
+/*
+ * Adaptive -- backs a parameter's sampling off while it is flat.  After
+ * every ADAPTIVE_RUN samples within tolerance of the value that began
+ * the flat stretch, the interval doubles, up to ADAPTIVE_MAX times.  A
+ * sample that moves further than that, or that falls outside the band
+ * [low, high], puts it straight back to full rate.
+ */
+typedef struct
+{
+  gboolean on;
+  gdouble tolerance, low, high;
+  gdouble ref;
+  gint flat, stretch;
+}
+Adaptive;
+
+void adaptive_init(Adaptive *ad, const char *spec);
+gint adaptive_next(Adaptive *ad, gdouble val);
+
+void wheel_add(Wheel *wheel, Wheel_timer *timer, guint delay);
+void wheel_remove(Wheel *wheel, Wheel_timer *timer);
+GSList *wheel_advance(Wheel *wheel);
+
+#endif /* WHEEL_H */